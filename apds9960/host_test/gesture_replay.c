@@ -0,0 +1,164 @@
+// Replays traces of gesture datasets through apds9960_service()
+//
+// A trace lists the gestures, each one is
+//   gesture <up|down|left|right|none>     the direction expected at the exit
+//   <up> <down> <left> <right>            a dataset added to the FIFO
+//   error                                 the next FIFO read fails
+//   end                                   the engine exits
+// and the lines starting with # are comments. The sensor is serviced as the
+// INT handler of app_main.cpp does, again while INT is low.
+
+#include <string.h>
+
+#include "apds9960.h"
+#include "sim_bus.h"
+#include "host_test.h"
+
+//as GESTURE_SERVICE_ROUNDS in app_main.cpp
+#define SERVICE_ROUNDS 16
+
+typedef struct {
+    const char         *path;
+    int                 line_nb;
+    apds9960_gesture_t  expected;
+    bool                in_gesture;
+    bool                ended;
+    int                 gestures;
+} replay_t;
+
+static apds9960_gesture_t gesture_by_name(const char *name)
+{
+    for(int gesture=APDS9960_GESTURE_NONE;gesture<=APDS9960_GESTURE_RIGHT;gesture++)
+    {
+        if(strcmp(name, apds9960_gesture_name((apds9960_gesture_t)gesture)) == 0)
+        {
+            return (apds9960_gesture_t)gesture;
+        }
+    }
+    return (apds9960_gesture_t)-1;
+}
+
+static void service(replay_t *replay, apds9960_t *dev, sim_bus_t *sim)
+{
+    for(int round=0;(round<SERVICE_ROUNDS) && sim_bus_int_low(sim);round++)
+    {
+        apds9960_gesture_t gesture;
+        if(!apds9960_service(dev, &gesture))
+        {
+            continue;
+        }
+        if(replay->ended || !replay->in_gesture)
+        {
+            printf("FAIL %s:%d the gesture ended before its end line\n", replay->path, replay->line_nb);
+            host_test_failures++;
+        }
+        else if(gesture != replay->expected)
+        {
+            printf("FAIL %s:%d gesture %s, expected %s\n", replay->path, replay->line_nb,
+                    apds9960_gesture_name(gesture), apds9960_gesture_name(replay->expected));
+            host_test_failures++;
+        }
+        replay->ended = true;
+    }
+    if(sim_bus_int_low(sim))
+    {
+        printf("FAIL %s:%d INT still low after %d services\n", replay->path, replay->line_nb, SERVICE_ROUNDS);
+        host_test_failures++;
+    }
+}
+
+static void replay_file(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+    {
+        printf("FAIL cannot open %s\n", path);
+        host_test_failures++;
+        return;
+    }
+    sim_bus_t sim;
+    apds9960_bus_t bus;
+    apds9960_t dev;
+    sim_bus_init(&sim, &bus);
+    CHECK(apds9960_init(&dev, &bus));
+    replay_t replay;
+    memset(&replay, 0, sizeof(replay));
+    replay.path = path;
+    char line[128];
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        replay.line_nb++;
+        char name[16];
+        int up, down, left, right;
+        if((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+        if(sscanf(line, "gesture %15s", name) == 1)
+        {
+            replay.expected = gesture_by_name(name);
+            replay.in_gesture = true;
+            replay.ended = false;
+        }
+        else if(sscanf(line, "%d %d %d %d", &up, &down, &left, &right) == 4)
+        {
+            uint8_t dataset[4] = {(uint8_t)up, (uint8_t)down, (uint8_t)left, (uint8_t)right};
+            sim_bus_push(&sim, dataset);
+            service(&replay, &dev, &sim);
+        }
+        else if(strncmp(line, "error", 5) == 0)
+        {
+            sim.fail_reads++;
+        }
+        else if(strncmp(line, "end", 3) == 0)
+        {
+            sim_bus_exit(&sim);
+            service(&replay, &dev, &sim);
+            if(!replay.ended)
+            {
+                printf("FAIL %s:%d no gesture reported at the exit\n", path, replay.line_nb);
+                host_test_failures++;
+            }
+            replay.in_gesture = false;
+            replay.gestures++;
+        }
+        else
+        {
+            printf("FAIL %s:%d unknown line %s", path, replay.line_nb, line);
+            host_test_failures++;
+        }
+    }
+    fclose(file);
+    printf("%s: %d gestures, %u datasets, %u bus errors, %u reads\n", path, replay.gestures,
+            dev.datasets, dev.bus_errors, sim.reads);
+}
+
+static void check_init(void)
+{
+    sim_bus_t sim;
+    apds9960_bus_t bus;
+    apds9960_t dev;
+    sim_bus_init(&sim, &bus);
+    CHECK(!apds9960_resume(&dev, &bus));
+    CHECK(apds9960_init(&dev, &bus));
+    CHECK(apds9960_resume(&dev, &bus));
+    //not an APDS-9960
+    sim_bus_init(&sim, &bus);
+    sim.regs[0x92] = 0x55;
+    CHECK(!apds9960_init(&dev, &bus));
+}
+
+int main(int argc, char **argv)
+{
+    check_init();
+    if(argc < 2)
+    {
+        printf("FAIL no trace given\n");
+        host_test_failures++;
+    }
+    for(int i=1;i<argc;i++)
+    {
+        replay_file(argv[i]);
+    }
+    return host_test_result();
+}
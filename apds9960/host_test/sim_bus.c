@@ -0,0 +1,127 @@
+/*
+ * sim_bus.c
+ *
+ * see sim_bus.h
+ */
+
+#include <string.h>
+
+#include "sim_bus.h"
+
+#define REG_ID          0x92
+#define REG_GCONF1      0xA2
+#define REG_GCONF4      0xAB
+#define REG_GFLVL       0xAE
+#define REG_GSTATUS     0xAF
+#define REG_AICLEAR     0xE7
+#define REG_GFIFO_U     0xFC
+
+#define GCONF4_GMODE    0x01
+#define GCONF4_GIEN     0x02
+#define GCONF4_GFIFO_CLR 0x04
+
+#define GSTATUS_GVALID  0x01
+#define GSTATUS_GFOV    0x02
+
+static bool sim_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len)
+{
+    sim_bus_t *sim = (sim_bus_t *)ctx;
+    if(len == 0)
+    {
+        return true;
+    }
+    if((reg == REG_GCONF4) && (data[0] & GCONF4_GFIFO_CLR))
+    {
+        sim->level = 0;
+        sim->overflow = false;
+        sim->exited = false;
+    }
+    sim->regs[reg] = data[0] & ~GCONF4_GFIFO_CLR;
+    return true;
+}
+
+static bool sim_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    sim_bus_t *sim = (sim_bus_t *)ctx;
+    sim->reads++;
+    switch(reg)
+    {
+        case REG_GCONF4:
+            data[0] = (sim->regs[REG_GCONF4] & ~GCONF4_GMODE) | (sim->gmode ? GCONF4_GMODE : 0);
+            return true;
+        case REG_GSTATUS:
+            data[0] = ((sim->level > 0) ? GSTATUS_GVALID : 0) | (sim->overflow ? GSTATUS_GFOV : 0);
+            return true;
+        case REG_GFLVL:
+            data[0] = sim->level;
+            if(sim->level == 0)
+            {
+                sim->exited = false;
+            }
+            return true;
+        case REG_GFIFO_U:
+        {
+            if(sim->fail_reads > 0)
+            {
+                sim->fail_reads--;
+                return false;
+            }
+            int datasets = len / 4;
+            if((len % 4 != 0) || (datasets > sim->level))
+            {
+                return false;
+            }
+            memcpy(data, sim->fifo, len);
+            memmove(sim->fifo, sim->fifo + len, (sim->level - datasets) * 4);
+            sim->level -= datasets;
+            if(sim->level == 0)
+            {
+                sim->overflow = false;
+                sim->exited = false;
+            }
+            return true;
+        }
+        default:
+            memcpy(data, &sim->regs[reg], len);
+            return true;
+    }
+}
+
+void sim_bus_init(sim_bus_t *sim, apds9960_bus_t *bus)
+{
+    memset(sim, 0, sizeof(sim_bus_t));
+    sim->regs[REG_ID] = 0xAB;
+    bus->write = &sim_write;
+    bus->read = &sim_read;
+    bus->ctx = sim;
+}
+
+void sim_bus_push(sim_bus_t *sim, const uint8_t dataset[4])
+{
+    sim->gmode = true;
+    if(sim->level == APDS9960_FIFO_DATASETS)
+    {
+        sim->overflow = true;
+        return;
+    }
+    memcpy(&sim->fifo[sim->level * 4], dataset, 4);
+    sim->level++;
+}
+
+void sim_bus_exit(sim_bus_t *sim)
+{
+    sim->gmode = false;
+    sim->exited = true;
+}
+
+bool sim_bus_int_low(const sim_bus_t *sim)
+{
+    if(!(sim->regs[REG_GCONF4] & GCONF4_GIEN))
+    {
+        return false;
+    }
+    //GFIFOTH in GCONF1 bits 7:6
+    static const int thresholds[4] = {1, 4, 8, 16};
+    int threshold = thresholds[sim->regs[REG_GCONF1] >> 6];
+    return (sim->level >= threshold) || sim->exited;
+}
@@ -0,0 +1,46 @@
+/*
+ * sim_bus.h
+ *
+ * A simulated APDS-9960 behind apds9960_bus_t : the registers written by the
+ * driver are kept, the gesture FIFO is filled by the test and read by the
+ * driver from GFIFO_U, and INT follows the FIFO level as on the sensor.
+ * The exit of the engine also pulls INT, until the FIFO is found empty.
+ */
+
+#ifndef HOST_TEST_SIM_BUS_H_
+#define HOST_TEST_SIM_BUS_H_
+
+#include "apds9960.h"
+
+typedef struct {
+    uint8_t     regs[256];
+    uint8_t     fifo[APDS9960_FIFO_DATASETS * 4];
+    int         level;          //datasets in the FIFO
+    bool        gmode;          //gesture engine running
+    bool        exited;         //engine exit not serviced yet
+    bool        overflow;
+    int         fail_reads;     //next FIFO reads that fail
+    uint32_t    reads;
+} sim_bus_t;
+
+/**
+ * @brief a sensor answering with the APDS-9960 id, fills the bus
+ */
+void sim_bus_init(sim_bus_t *sim, apds9960_bus_t *bus);
+
+/**
+ * @brief the engine adds a dataset, it enters gesture mode on the first one
+ */
+void sim_bus_push(sim_bus_t *sim, const uint8_t dataset[4]);
+
+/**
+ * @brief the proximity fell under GEXTH, the engine exits
+ */
+void sim_bus_exit(sim_bus_t *sim);
+
+/**
+ * @return true when the sensor pulls INT low
+ */
+bool sim_bus_int_low(const sim_bus_t *sim);
+
+#endif /* HOST_TEST_SIM_BUS_H_ */
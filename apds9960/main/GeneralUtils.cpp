@@ -44,13 +44,6 @@ static void a3_to_a4(unsigned char* a4, unsigned char* a3) {
 } // a3_to_a4
 
 
-static void a4_to_a3(unsigned char* a3, unsigned char* a4) {
-	a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
-	a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
-	a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
-} // a4_to_a3
-
-
 /**
  * @brief Encode a string into base 64.
  * @param [in] in
@@ -123,7 +116,7 @@ void GeneralUtils::dumpInfo() {
  * @param [in] c The character to look form.
  * @return True if the string ends with the given character.
  */
-bool GeneralUtils::endsWith(std::string str, char c) {
+bool GeneralUtils::endsWith(const std::string& str, char c) {
 	if (str.empty()) {
 		return false;
 	}
@@ -134,82 +127,226 @@ bool GeneralUtils::endsWith(std::string str, char c) {
 } // endsWidth
 
 
-static int DecodedLength(const std::string& in) {
-	int numEq = 0;
-	int n = (int) in.size();
+// 6-bit value of each base64 character, kBase64Pad for '=' and kBase64Invalid
+// for anything else, so that a single OR of the lookups validates a quad.
+static const uint8_t kBase64Pad     = 0xFE;
+static const uint8_t kBase64Invalid = 0xFF;
+static const uint8_t kBase64Reverse[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
 
-	for (std::string::const_reverse_iterator it = in.rbegin(); *it == '='; ++it) {
-		++numEq;
-	}
-	return ((6 * n) / 8) - numEq;
-} // DecodedLength
+/**
+ * @brief Create a decoder ready for the first chunk.
+ */
+Base64Decoder::Base64Decoder() {
+	reset();
+} // Base64Decoder
 
 
-static unsigned char b64_lookup(unsigned char c) {
-	if(c >='A' && c <='Z') return c - 'A';
-	if(c >='a' && c <='z') return c - 71;
-	if(c >='0' && c <='9') return c + 4;
-	if(c == '+') return 62;
-	if(c == '/') return 63;
-	return 255;
-}; // b64_lookup
+/**
+ * @brief Forget the pending input and any error, to decode a new string.
+ */
+void Base64Decoder::reset() {
+	m_bits    = 0;
+	m_count   = 0;
+	m_padding = 0;
+	m_ended   = false;
+	m_error   = false;
+} // reset
 
 
 /**
- * @brief Decode a chunk of data that is base64 encoded.
- * @param [in] in The string to be decoded.
- * @param [out] out The resulting data.
+ * @brief Write the bytes of the pending sextets of a quad that ends early.
+ * 2 sextets give 1 byte, 3 sextets give 2 bytes.
  */
-bool GeneralUtils::base64Decode(const std::string& in, std::string* out) {
-	int i = 0, j = 0;
-	size_t dec_len = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-
-	int input_len = in.size();
-	std::string::const_iterator input = in.begin();
+int Base64Decoder::flushPartial(uint8_t* out, size_t outSize) {
+	size_t bytes = m_count - 1;
+	if (bytes > outSize) {
+		m_error = true;
+		return -1;
+	}
+	uint32_t bits = m_bits << (6 * (4 - m_count));
+	out[0] = bits >> 16;
+	if (bytes == 2) {
+		out[1] = bits >> 8;
+	}
+	m_bits  = 0;
+	m_count = 0;
+	return bytes;
+} // flushPartial
 
-	out->resize(DecodedLength(in));
 
-	while (input_len--) {
-		if (*input == '=') {
-			break;
+/**
+ * @brief Decode a chunk of base64 text.
+ *
+ * The chunks do not need to be aligned on quads, the sextets left over are
+ * kept for the next chunk. Whole quads are decoded straight from the input
+ * with a single check of the four lookups.
+ *
+ * @param [in] in The base64 characters, not null terminated.
+ * @param [in] length The number of characters.
+ * @param [out] out The decoded bytes, maxDecodedLength(length) is always enough.
+ * @param [in] outSize The size of out.
+ * @return The number of bytes written, -1 on an invalid character, a misplaced
+ * padding or when out is too small. The decoder stays in error until reset().
+ */
+int Base64Decoder::decode(const char* in, size_t length, uint8_t* out, size_t outSize) {
+	if (m_error) {
+		return -1;
+	}
+	const uint8_t* src    = reinterpret_cast<const uint8_t*>(in);
+	const uint8_t* srcEnd = src + length;
+	uint8_t*       dst    = out;
+	uint8_t*       dstEnd = out + outSize;
+
+	while (src < srcEnd) {
+		if (m_count == 0 && m_padding == 0) {
+			while (srcEnd - src >= 4 && dstEnd - dst >= 3) {
+				uint32_t a = kBase64Reverse[src[0]];
+				uint32_t b = kBase64Reverse[src[1]];
+				uint32_t c = kBase64Reverse[src[2]];
+				uint32_t d = kBase64Reverse[src[3]];
+				if ((a | b | c | d) & 0xC0) {
+					break; // padding or invalid, sorted out one character at a time
+				}
+				uint32_t bits = (a << 18) | (b << 12) | (c << 6) | d;
+				dst[0] = bits >> 16;
+				dst[1] = bits >> 8;
+				dst[2] = bits;
+				src += 4;
+				dst += 3;
+			}
+			if (src == srcEnd) {
+				break;
+			}
 		}
 
-		a4[i++] = *(input++);
-		if (i == 4) {
-			for (i = 0; i <4; i++) {
-				a4[i] = b64_lookup(a4[i]);
+		uint8_t value = kBase64Reverse[*src++];
+		if (m_ended || value == kBase64Invalid) {
+			m_error = true;
+			return -1;
+		}
+		if (value == kBase64Pad) {
+			// "xx==" or "xxx=", nothing may follow
+			if (m_count < 2 || m_count + m_padding >= 4) {
+				m_error = true;
+				return -1;
 			}
-
-			a4_to_a3(a3,a4);
-
-			for (i = 0; i < 3; i++) {
-				(*out)[dec_len++] = a3[i];
+			m_padding++;
+			if (m_count + m_padding == 4) {
+				int bytes = flushPartial(dst, dstEnd - dst);
+				if (bytes < 0) {
+					return -1;
+				}
+				dst += bytes;
+				m_ended = true;
 			}
-
-			i = 0;
+			continue;
+		}
+		if (m_padding) {
+			m_error = true;
+			return -1;
+		}
+		m_bits = (m_bits << 6) | value;
+		if (++m_count == 4) {
+			if (dstEnd - dst < 3) {
+				m_error = true;
+				return -1;
+			}
+			dst[0] = m_bits >> 16;
+			dst[1] = m_bits >> 8;
+			dst[2] = m_bits;
+			dst += 3;
+			m_bits  = 0;
+			m_count = 0;
 		}
 	}
+	return dst - out;
+} // decode
 
-	if (i) {
-		for (j = i; j < 4; j++) {
-			a4[j] = '\0';
-		}
 
-		for (j = 0; j < 4; j++) {
-			a4[j] = b64_lookup(a4[j]);
-		}
+/**
+ * @brief End the string, the last quad may come without its padding.
+ * @param [out] out Room for the last bytes, at most 2.
+ * @param [in] outSize The size of out.
+ * @return The number of bytes written, -1 if the input was not valid base64.
+ * The decoder is reset for the next string.
+ */
+int Base64Decoder::finish(uint8_t* out, size_t outSize) {
+	int bytes = 0;
+	if (m_error || m_count == 1 || (m_padding && !m_ended)) {
+		bytes = -1;
+	} else if (m_count) {
+		bytes = flushPartial(out, outSize);
+	}
+	reset();
+	return bytes;
+} // finish
 
-		a4_to_a3(a3,a4);
 
-		for (j = 0; j < i - 1; j++) {
-			(*out)[dec_len++] = a3[j];
-		}
+/**
+ * @brief The most bytes that decoding length characters can give, whatever
+ * is pending in a decoder.
+ */
+size_t Base64Decoder::maxDecodedLength(size_t length) {
+	return (length + 3) / 4 * 3;
+} // maxDecodedLength
+
+
+/**
+ * @brief Decode a base64 string into a caller buffer, without allocation.
+ * @param [in] in The base64 characters, not null terminated.
+ * @param [in] length The number of characters.
+ * @param [out] out The decoded bytes.
+ * @param [in] outSize The size of out.
+ * @return The number of bytes decoded, -1 if the input is not valid base64 or
+ * does not fit in out.
+ */
+int GeneralUtils::base64Decode(const char* in, size_t length, uint8_t* out, size_t outSize) {
+	Base64Decoder decoder;
+	int bytes = decoder.decode(in, length, out, outSize);
+	if (bytes < 0) {
+		return -1;
 	}
+	int last = decoder.finish(out + bytes, outSize - bytes);
+	if (last < 0) {
+		return -1;
+	}
+	return bytes + last;
+} // base64Decode
+
 
-	return (dec_len == out->size());
- } // base64Decode
+/**
+ * @brief Decode a chunk of data that is base64 encoded.
+ * @param [in] in The string to be decoded.
+ * @param [out] out The resulting data.
+ * @return False if the input is not valid base64.
+ */
+bool GeneralUtils::base64Decode(const std::string& in, std::string* out) {
+	out->resize(Base64Decoder::maxDecodedLength(in.size()));
+	int bytes = base64Decode(in.data(), in.size(), reinterpret_cast<uint8_t*>(&(*out)[0]), out->size());
+	if (bytes < 0) {
+		out->clear();
+		return false;
+	}
+	out->resize(bytes);
+	return true;
+} // base64Decode
 
 /*
 void GeneralUtils::hexDump(uint8_t* pData, uint32_t length) {
@@ -358,6 +495,117 @@ std::vector<std::string> GeneralUtils::split(std::string source, char delimiter)
 } // split
 
 
+static char asciiLower(char c) {
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+} // asciiLower
+
+
+/**
+ * @brief An empty view.
+ */
+StringView::StringView() : ptr(""), length(0) {
+} // StringView
+
+
+/**
+ * @brief A view of length characters from ptr.
+ */
+StringView::StringView(const char* ptr, size_t length) : ptr(ptr), length(ptr ? length : 0) {
+} // StringView
+
+
+/**
+ * @brief A view of a null terminated string, NULL gives an empty view.
+ */
+StringView::StringView(const char* text) : ptr(text), length(text ? strlen(text) : 0) {
+} // StringView
+
+
+bool StringView::empty() const {
+	return length == 0;
+} // empty
+
+
+/**
+ * @brief Does the view end with a specific character?
+ */
+bool StringView::endsWith(char c) const {
+	return length > 0 && ptr[length - 1] == c;
+} // endsWith
+
+
+/**
+ * @brief Compare with a null terminated string.
+ */
+bool StringView::equals(const char* text) const {
+	return strlen(text) == length && memcmp(ptr, text, length) == 0;
+} // equals
+
+
+/**
+ * @brief Compare with a null terminated string, ignoring the case of the ASCII letters.
+ */
+bool StringView::equalsIgnoreCase(const char* text) const {
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == '\0' || asciiLower(ptr[i]) != asciiLower(text[i])) {
+			return false;
+		}
+	}
+	return text[length] == '\0';
+} // equalsIgnoreCase
+
+
+/**
+ * @brief The same characters without the leading and trailing spaces.
+ */
+StringView StringView::trim() const {
+	const char* first = ptr;
+	const char* last  = ptr + length;
+	while (first < last && *first == ' ') {
+		first++;
+	}
+	while (last > first && last[-1] == ' ') {
+		last--;
+	}
+	return StringView(first, last - first);
+} // trim
+
+
+/**
+ * @brief Prepare the split of source, nothing is copied so it must outlive the tokenizer.
+ * @param [in] source The characters to split, not null terminated.
+ * @param [in] length The number of characters.
+ * @param [in] delimiter The delimiter character.
+ */
+Tokenizer::Tokenizer(const char* source, size_t length, char delimiter) :
+	m_ptr(source), m_end(source + length), m_delimiter(delimiter) {
+} // Tokenizer
+
+
+/**
+ * @brief Get the next token, trimmed.
+ *
+ * Gives the same tokens as split(): two delimiters in a row give an empty token,
+ * a delimiter at the end does not. A token of spaces only is empty.
+ *
+ * @param [out] token The view of the token in the source.
+ * @return False when there is no more token.
+ */
+bool Tokenizer::next(StringView* token) {
+	if (m_ptr >= m_end) {
+		return false;
+	}
+	const char* start = m_ptr;
+	const char* stop  = static_cast<const char*>(memchr(start, m_delimiter, m_end - start));
+	if (stop == nullptr) {
+		stop = m_end;
+	}
+	m_ptr = stop + 1;
+	*token = StringView(start, stop - start).trim();
+	return true;
+} // next
+
+
 /**
  * @brief Convert an ESP error code to a string.
  * @param [in] errCode The errCode to be converted.
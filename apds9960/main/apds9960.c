@@ -0,0 +1,217 @@
+/*
+ * apds9960.c
+ *
+ * see apds9960.h
+ */
+
+#include <string.h>
+
+#include "apds9960.h"
+
+#define REG_ENABLE      0x80
+#define REG_WTIME       0x83
+#define REG_PPULSE      0x8E
+#define REG_CONTROL     0x8F
+#define REG_CONFIG2     0x90
+#define REG_ID          0x92
+#define REG_GPENTH      0xA0
+#define REG_GEXTH       0xA1
+#define REG_GCONF1      0xA2
+#define REG_GCONF2      0xA3
+#define REG_GPULSE      0xA6
+#define REG_GCONF3      0xAA
+#define REG_GCONF4      0xAB
+#define REG_GFLVL       0xAE
+#define REG_GSTATUS     0xAF
+#define REG_AICLEAR     0xE7
+#define REG_GFIFO_U     0xFC
+
+#define ENABLE_PON      0x01
+#define ENABLE_PEN      0x04
+#define ENABLE_WEN      0x08
+#define ENABLE_GEN      0x40
+
+#define GCONF4_GMODE    0x01
+#define GCONF4_GIEN     0x02
+#define GCONF4_GFIFO_CLR 0x04
+
+#define GSTATUS_GFOV    0x02
+
+//FIFO reads of a single service, the engine adds a dataset every few ms
+#define MAX_BURSTS      4
+
+typedef struct {
+    uint8_t reg;
+    uint8_t value;
+} reg_value_t;
+
+static const reg_value_t g_config[] = {
+    {REG_ENABLE,    0x00},                      //off while configuring
+    {REG_WTIME,     0xFF},                      //2.78 ms wait between the cycles
+    {REG_PPULSE,    0x89},                      //proximity 16 us, 10 pulses
+    {REG_CONTROL,   0x08},                      //led 100 mA, proximity gain 4x
+    {REG_CONFIG2,   0x01},                      //no led boost
+    {REG_GPENTH,    40},                        //gesture engine entry
+    {REG_GEXTH,     30},                        //and exit proximity
+    {REG_GCONF1,    0x40},                      //INT at 4 datasets, exit after 1 under GEXTH
+    {REG_GCONF2,    0x41},                      //gain 4x, led 100 mA, 2.8 ms between datasets
+    {REG_GPULSE,    0x89},                      //16 us, 10 pulses
+    {REG_GCONF3,    0x00},                      //all four photodiodes
+    {REG_GCONF4,    GCONF4_GFIFO_CLR},
+    {REG_GCONF4,    GCONF4_GIEN},
+    {REG_ENABLE,    ENABLE_PON | ENABLE_PEN | ENABLE_WEN | ENABLE_GEN},
+};
+
+static bool read_reg(apds9960_t *dev, uint8_t reg, uint8_t *value, size_t len)
+{
+    if(!dev->bus.read(dev->bus.ctx, reg, value, len))
+    {
+        dev->bus_errors++;
+        return false;
+    }
+    return true;
+}
+
+bool apds9960_init(apds9960_t *dev, const apds9960_bus_t *bus)
+{
+    memset(dev, 0, sizeof(apds9960_t));
+    dev->bus = *bus;
+    uint8_t id;
+    if(!read_reg(dev, REG_ID, &id, 1))
+    {
+        return false;
+    }
+    //0xAB in the datasheet, 0xA8 and 0x9C are found on clones
+    if((id != 0xAB) && (id != 0xA8) && (id != 0x9C))
+    {
+        return false;
+    }
+    for(size_t i=0;i<sizeof(g_config)/sizeof(g_config[0]);i++)
+    {
+        if(!dev->bus.write(dev->bus.ctx, g_config[i].reg, &g_config[i].value, 1))
+        {
+            dev->bus_errors++;
+            return false;
+        }
+    }
+    dev->bus.write(dev->bus.ctx, REG_AICLEAR, NULL, 0);
+    apds9960_classifier_reset(&dev->classifier);
+    return true;
+}
+
+bool apds9960_resume(apds9960_t *dev, const apds9960_bus_t *bus)
+{
+    memset(dev, 0, sizeof(apds9960_t));
+    dev->bus = *bus;
+    uint8_t enable, gconf4;
+    if(!read_reg(dev, REG_ENABLE, &enable, 1) || !read_reg(dev, REG_GCONF4, &gconf4, 1))
+    {
+        return false;
+    }
+    apds9960_classifier_reset(&dev->classifier);
+    return ((enable & (ENABLE_PON | ENABLE_GEN)) == (ENABLE_PON | ENABLE_GEN)) && (gconf4 & GCONF4_GIEN);
+}
+
+bool apds9960_service(apds9960_t *dev, apds9960_gesture_t *gesture)
+{
+    //GMODE is read first, when it is already cleared no dataset can come after the FIFO is read
+    uint8_t gconf4, gstatus;
+    if(!read_reg(dev, REG_GCONF4, &gconf4, 1) || !read_reg(dev, REG_GSTATUS, &gstatus, 1))
+    {
+        return false;
+    }
+    if(gstatus & GSTATUS_GFOV)
+    {
+        dev->overflows++;
+    }
+    for(int burst=0;burst<MAX_BURSTS;burst++)
+    {
+        uint8_t level;
+        if(!read_reg(dev, REG_GFLVL, &level, 1) || (level == 0))
+        {
+            break;
+        }
+        if(level > APDS9960_FIFO_DATASETS)
+        {
+            level = APDS9960_FIFO_DATASETS;
+        }
+        if(!read_reg(dev, REG_GFIFO_U, dev->fifo, level * 4))
+        {
+            break;
+        }
+        apds9960_classifier_feed(&dev->classifier, dev->fifo, level);
+        dev->datasets += level;
+    }
+    if(gconf4 & GCONF4_GMODE)
+    {
+        return false;
+    }
+    *gesture = apds9960_classifier_result(&dev->classifier);
+    apds9960_classifier_reset(&dev->classifier);
+    if(*gesture != APDS9960_GESTURE_NONE)
+    {
+        dev->gestures++;
+    }
+    return true;
+}
+
+void apds9960_classifier_reset(apds9960_classifier_t *classifier)
+{
+    memset(classifier, 0, sizeof(apds9960_classifier_t));
+}
+
+void apds9960_classifier_feed(apds9960_classifier_t *classifier, const uint8_t *data, int datasets)
+{
+    for(int i=0;i<datasets;i++, data += 4)
+    {
+        int up = data[0], down = data[1], left = data[2], right = data[3];
+        if((up <= APDS9960_GESTURE_THRESHOLD) || (down <= APDS9960_GESTURE_THRESHOLD) ||
+           (left <= APDS9960_GESTURE_THRESHOLD) || (right <= APDS9960_GESTURE_THRESHOLD))
+        {
+            continue;
+        }
+        int16_t ud = ((up - down) * 100) / (up + down);
+        int16_t lr = ((left - right) * 100) / (left + right);
+        if(classifier->valid == 0)
+        {
+            classifier->ud_first = ud;
+            classifier->lr_first = lr;
+        }
+        classifier->ud_last = ud;
+        classifier->lr_last = lr;
+        classifier->valid++;
+    }
+}
+
+apds9960_gesture_t apds9960_classifier_result(const apds9960_classifier_t *classifier)
+{
+    if(classifier->valid < 2)
+    {
+        return APDS9960_GESTURE_NONE;
+    }
+    int ud_delta = classifier->ud_last - classifier->ud_first;
+    int lr_delta = classifier->lr_last - classifier->lr_first;
+    int ud_abs = (ud_delta < 0) ? -ud_delta : ud_delta;
+    int lr_abs = (lr_delta < 0) ? -lr_delta : lr_delta;
+    if((ud_abs < APDS9960_GESTURE_SENSITIVITY) && (lr_abs < APDS9960_GESTURE_SENSITIVITY))
+    {
+        return APDS9960_GESTURE_NONE;
+    }
+    if(ud_abs > lr_abs)
+    {
+        return (ud_delta > 0) ? APDS9960_GESTURE_DOWN : APDS9960_GESTURE_UP;
+    }
+    return (lr_delta > 0) ? APDS9960_GESTURE_RIGHT : APDS9960_GESTURE_LEFT;
+}
+
+const char *apds9960_gesture_name(apds9960_gesture_t gesture)
+{
+    switch(gesture)
+    {
+        case APDS9960_GESTURE_UP:       return "up";
+        case APDS9960_GESTURE_DOWN:     return "down";
+        case APDS9960_GESTURE_LEFT:     return "left";
+        case APDS9960_GESTURE_RIGHT:    return "right";
+        default:                        return "none";
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * apds9960.h
+ *
+ * Gesture mode of the APDS-9960, serviced from its INT line.
+ *
+ * The gesture engine starts when the proximity goes over GPENTH and fills a
+ * FIFO of (up, down, left, right) datasets until all the channels fall under
+ * GEXTH. The INT line is pulled low when the FIFO reaches 4 datasets and when
+ * the engine exits, apds9960_service() is called then and reads the whole
+ * FIFO in one burst from GFIFO_U, the register address wraps over the four
+ * FIFO registers.
+ *
+ * The classifier only uses integers : the (up - down) and (left - right)
+ * ratios in percent of the first and of the last dataset above the
+ * threshold, the bigger change of the two axes gives the direction. The
+ * directions are those of the breakout board with the sensor window up.
+ *
+ * The registers are accessed through apds9960_bus_t, the I2C bus is given by
+ * apds9960_i2c.h, a simulated bus can replay recorded FIFO data.
+ *
+ * @code{.c}
+ * apds9960_bus_t bus;
+ * apds9960_i2c_init(I2C_NUM_0, GPIO_NUM_21, GPIO_NUM_22, &bus);
+ * apds9960_init(&sensor, &bus);
+ * ...
+ * //when INT falls
+ * apds9960_gesture_t gesture;
+ * if(apds9960_service(&sensor, &gesture) && (gesture != APDS9960_GESTURE_NONE))
+ * {
+ *     ESP_LOGI(TAG, "gesture %s", apds9960_gesture_name(gesture));
+ * }
+ * @endcode
+ */
+
+#ifndef MAIN_APDS9960_H_
+#define MAIN_APDS9960_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//datasets with a channel under this are ignored by the classifier
+#ifndef APDS9960_GESTURE_THRESHOLD
+#define APDS9960_GESTURE_THRESHOLD 10
+#endif
+
+//minimal change of a ratio in percent to report a direction
+#ifndef APDS9960_GESTURE_SENSITIVITY
+#define APDS9960_GESTURE_SENSITIVITY 30
+#endif
+
+#define APDS9960_FIFO_DATASETS 32
+
+typedef struct {
+    //both return false on a bus error, len can be 0 for a register address only write
+    bool    (*write)(void *ctx, uint8_t reg, const uint8_t *data, size_t len);
+    bool    (*read)(void *ctx, uint8_t reg, uint8_t *data, size_t len);
+    void   *ctx;
+} apds9960_bus_t;
+
+typedef enum {
+    APDS9960_GESTURE_NONE,
+    APDS9960_GESTURE_UP,
+    APDS9960_GESTURE_DOWN,
+    APDS9960_GESTURE_LEFT,
+    APDS9960_GESTURE_RIGHT
+} apds9960_gesture_t;
+
+typedef struct {
+    int16_t     ud_first;
+    int16_t     lr_first;
+    int16_t     ud_last;
+    int16_t     lr_last;
+    uint16_t    valid;      //datasets above the threshold
+} apds9960_classifier_t;
+
+typedef struct {
+    apds9960_bus_t          bus;
+    apds9960_classifier_t   classifier;
+    uint8_t                 fifo[APDS9960_FIFO_DATASETS * 4];
+    uint32_t                datasets;
+    uint32_t                gestures;
+    uint32_t                overflows;  //FIFO full, datasets were lost
+    uint32_t                bus_errors;
+} apds9960_t;
+
+/**
+ * @brief checks the device id and starts the proximity and gesture engines with the gesture interrupt
+ * @return false if the sensor does not answer or is not an APDS-9960
+ */
+bool apds9960_init(apds9960_t *dev, const apds9960_bus_t *bus);
+
+/**
+ * @brief takes over a sensor already configured by apds9960_init(), e.g. after a deep sleep of the
+ * ESP32, without clearing the FIFO of the gesture that woke it
+ * @return false if the sensor does not answer or is not in gesture mode, apds9960_init() is then needed
+ */
+bool apds9960_resume(apds9960_t *dev, const apds9960_bus_t *bus);
+
+/**
+ * @brief reads the FIFO, to call when the INT line is low
+ * @param [out] gesture set when the gesture ended, NONE if it was not recognized
+ * @return true when the gesture engine has exited
+ */
+bool apds9960_service(apds9960_t *dev, apds9960_gesture_t *gesture);
+
+void apds9960_classifier_reset(apds9960_classifier_t *classifier);
+
+/**
+ * @param [in] data datasets of 4 bytes, up down left right as in the FIFO
+ */
+void apds9960_classifier_feed(apds9960_classifier_t *classifier, const uint8_t *data, int datasets);
+
+/**
+ * @brief the direction of the datasets fed since the last reset
+ */
+apds9960_gesture_t apds9960_classifier_result(const apds9960_classifier_t *classifier);
+
+const char *apds9960_gesture_name(apds9960_gesture_t gesture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_APDS9960_H_ */
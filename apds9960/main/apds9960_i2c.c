@@ -0,0 +1,76 @@
+/*
+ * apds9960_i2c.c
+ *
+ * see apds9960_i2c.h
+ */
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+#include "apds9960_i2c.h"
+
+static const char *TAG = "apds9960_i2c";
+
+#define I2C_TIMEOUT_MS 10
+
+static bool bus_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len)
+{
+    i2c_port_t port = (i2c_port_t)(intptr_t)ctx;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDRESS << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    if(len > 0)
+    {
+        i2c_master_write(cmd, (uint8_t *)data, len, true);
+    }
+    i2c_master_stop(cmd);
+    esp_err_t res = i2c_master_cmd_begin(port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return (res == ESP_OK);
+}
+
+//a single transaction with a repeated start, the FIFO is read in one burst
+static bool bus_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    i2c_port_t port = (i2c_port_t)(intptr_t)ctx;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDRESS << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDRESS << 1) | I2C_MASTER_READ, true);
+    if(len > 1)
+    {
+        i2c_master_read(cmd, data, len - 1, I2C_MASTER_ACK);
+    }
+    i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t res = i2c_master_cmd_begin(port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return (res == ESP_OK);
+}
+
+bool apds9960_i2c_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, apds9960_bus_t *bus)
+{
+    i2c_config_t conf;
+    conf.mode = I2C_MODE_MASTER;
+    conf.sda_io_num = sda;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_io_num = scl;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.master.clk_speed = 400000;
+    i2c_param_config(port, &conf);
+    esp_err_t res = i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0);
+    if(res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "i2c_driver_install() failed (%d)", res);
+        return false;
+    }
+    bus->write = &bus_write;
+    bus->read = &bus_read;
+    bus->ctx = (void *)(intptr_t)port;
+    return true;
+}
@@ -0,0 +1,31 @@
+/*
+ * apds9960_i2c.h
+ *
+ * apds9960_bus_t over an ESP32 I2C master port.
+ */
+
+#ifndef MAIN_APDS9960_I2C_H_
+#define MAIN_APDS9960_I2C_H_
+
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+
+#include "apds9960.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APDS9960_I2C_ADDRESS 0x39
+
+/**
+ * @brief installs the master driver at 400 kHz with the internal pull-ups and fills the bus
+ * @return false if the driver could not be installed
+ */
+bool apds9960_i2c_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, apds9960_bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_APDS9960_I2C_H_ */
@@ -23,8 +23,23 @@
 
 #include "esp_log.h"
 #include "mqtt_client.h"
+#include "iot_core.h"
+#include "boot_timeline.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "battery_monitor.h"
+#include "adc_cal_lut.h"
+#include "gpio_events.h"
+#include "sleep_cycle.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+#include "apds9960.h"
+#include "apds9960_i2c.h"
 
 #include "WS2812.h"
+//the payloads come from our own controllers, strict JSON without comments
+#define ARDUINOJSON_ENABLE_COMMENTS 0
 #include "ArduinoJson.hpp"
 
 static const char *TAG          = "MQTT_EXAMPLE";
@@ -33,22 +48,33 @@ static const char* TOPIC_ALL    = "esp/rgb led/all";
 static const char* TOPIC_ONE    = "esp/rgb led/one";
 static const char* TOPIC_STATUS = "esp/rgb led/status";
 static const char* TOPIC_SUB    = "esp/rgb led/#";
+static const char* TOPIC_TELEMETRY = "esp/rgb led/telemetry";
+static const char* TOPIC_GESTURE = "esp/rgb led/gesture";
+//the battery topic of the previous versions, published next to the telemetry
+//until its subscribers read the document, 0 to drop it
+#define LEGACY_TOPICS 1
+#if LEGACY_TOPICS
 static const char* TOPIC_BATTERY = "esp/rgb led/battery";
+#endif
 
 
-
-static EventGroupHandle_t wifi_event_group;
-const static int CONNECTED_BIT = BIT0;
-
-esp_mqtt_client_handle_t g_client;
-bool is_client_ready = false;
-
 const gpio_num_t BLUE_LED=(gpio_num_t)2;
 const gpio_num_t RGB_GPIO=(gpio_num_t)13;
 const gpio_num_t V_BAT_GPIO=(gpio_num_t)15;
+const gpio_num_t GESTURE_SDA_GPIO=(gpio_num_t)21;
+const gpio_num_t GESTURE_SCL_GPIO=(gpio_num_t)22;
+const gpio_num_t GESTURE_INT_GPIO=(gpio_num_t)4;     //RTC capable, wakes from deep sleep
+
+//the node sleeps between the events, 0 to stay awake with the alive led blinking
+#define DUTY_CYCLE          1
+#define SLEEP_PERIOD_S      (10*60)
+#define HEARTBEAT_WAKES     6           //battery published at least every hour
+#define AWAKE_IDLE_MS       2000        //awake after the last command or gesture
+#define CONNECT_TIMEOUT_MS  10000
 
 #define DEFAULT_VREF    1100        //Use adc2_vref_to_gpio() to obtain a better estimate
-static esp_adc_cal_characteristics_t *adc_chars;
+static esp_adc_cal_characteristics_t adc_chars;
+static adc_cal_lut_t adc_lut;
 static const adc1_channel_t channel = ADC1_CHANNEL_5; //GPIO33 for ADC1
 static const adc_atten_t atten = ADC_ATTEN_DB_11;
 static const adc_unit_t unit = ADC_UNIT_1;
@@ -57,6 +83,10 @@ static const uint8_t g_nb_led = 7;
 
 WS2812 my_rgb(RGB_GPIO,g_nb_led);
 
+//all the json handlers run in the MQTT task, they share one arena kept between the messages
+static uint8_t json_pool[1024];
+static ArduinoJson::JsonArena json_arena(2048, json_pool, sizeof(json_pool));
+
 
 static void print_char_val_type(esp_adc_cal_value_t val_type)
 {
@@ -75,51 +105,80 @@ void adc_init()
     ESP_LOGI(TAG, "ADC Init\n");
     adc1_config_width(ADC_WIDTH_BIT_12);
     adc1_config_channel_atten(channel, atten);
-    adc_chars = new esp_adc_cal_characteristics_t;
-    esp_adc_cal_value_t val_type = esp_adc_cal_characterize(unit, atten, ADC_WIDTH_BIT_12, DEFAULT_VREF, adc_chars);
+    esp_adc_cal_value_t val_type = esp_adc_cal_characterize(unit, atten, ADC_WIDTH_BIT_12, DEFAULT_VREF, &adc_chars);
     print_char_val_type(val_type);
 }
 
-uint32_t adc_read()
+uint16_t adc_read_raw()
+{
+    return adc1_get_raw((adc1_channel_t)channel);
+}
+
+//the table is only built for the battery monitor task, a timer wake of the duty cycle
+//converts a single filtered code and goes back to sleep
+uint32_t adc_raw_to_mv(uint16_t raw)
+{
+    if(adc_lut.mv == NULL)
+    {
+        return esp_adc_cal_raw_to_voltage(raw, &adc_chars);
+    }
+    return adc_cal_lut_to_mv(&adc_lut, raw);
+}
+
+//the controllers may send the same objects in MessagePack, a map can not start a JSON text
+//the JSON text is decoded in place, the keys and strings of the object point into the payload
+static ArduinoJson::JsonObject& parse_payload(ArduinoJson::ArenaJsonBuffer &jsonBuffer, char * payload,int len)
+{
+    uint8_t first = (len > 0) ? (uint8_t)payload[0] : 0;
+    if(((first & 0xF0) == 0x80) || (first == 0xDE) || (first == 0xDF))
+    {
+        return jsonBuffer.parseMsgPackObject(payload, len);
+    }
+    return jsonBuffer.parseObject(ArduinoJson::SizedJson(payload, len));
+}
+
+void leds_changed()
 {
-    uint32_t adc_reading = adc1_get_raw((adc1_channel_t)channel);
-    return esp_adc_cal_raw_to_voltage(adc_reading, adc_chars);
+    battery_monitor_led_activity();
+    sleep_cycle_activity();
 }
 
-void rgb_led_set_all(const char * payload,int len)
+void rgb_led_set_all(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<200> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     uint8_t red = root["red"];
     uint8_t green = root["green"];
     uint8_t blue = root["blue"];
-    ESP_LOGI(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
+    LOG_RING_I(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
 
     for(int i=0;i<7;i++)
     {
         my_rgb.setPixel(i,red,green,blue);
     }
     my_rgb.show();
+    leds_changed();
 }
 
-void rgb_led_set_one(const char * payload,int len)
+void rgb_led_set_one(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<200> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     uint8_t index = root["index"];
     uint8_t red = root["red"];
     uint8_t green = root["green"];
     uint8_t blue = root["blue"];
-    ESP_LOGI(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
+    LOG_RING_I(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
 
     my_rgb.setPixel(index,red,green,blue);
     my_rgb.show();
+    leds_changed();
 }
 
-void rgb_led_set_list(const char * payload,int len)
+void rgb_led_set_list(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<800> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     if (!root.success()) 
     {
         ESP_LOGE(TAG, "MQTT-JSON> Parsing error");
@@ -127,158 +186,66 @@ void rgb_led_set_list(const char * payload,int len)
     }
     int size = root["leds"].size();
     int nb_leds = size / 3;
-    ESP_LOGI(TAG, "MQTT-JSON> size = %u",size);
+    LOG_RING_I(TAG, "MQTT-JSON> size = %u",size);
     for(int i=0;i<nb_leds;i++)
     {
         uint8_t red = root["leds"][3*i];
         uint8_t green = root["leds"][3*i+1];
         uint8_t blue = root["leds"][3*i+2];
         my_rgb.setPixel(i,red,green,blue);
-        ESP_LOGI(TAG, "MQTT-JSON> rgb[%u](%u , %u , %u)",i,red, green, blue);
+        LOG_RING_I(TAG, "MQTT-JSON> rgb[%u](%u , %u , %u)",i,red, green, blue);
     }
     my_rgb.show();
+    leds_changed();
 }
 
+topic_router_t router;
 
-static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
+void mqtt_routes_init()
 {
-    g_client = event->client;//update g_client
-    int msg_id;
-    // your_context_t *context = event->context;
-    switch (event->event_id) {
-        case MQTT_EVENT_CONNECTED:
-            is_client_ready = true;
-            ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
-            msg_id = esp_mqtt_client_publish(g_client, TOPIC_STATUS, "online", 0, 1, 1);
-            ESP_LOGI(TAG, "MQTT> sent publish successful, msg_id=%d", msg_id);
-
-            msg_id = esp_mqtt_client_subscribe(g_client, TOPIC_SUB, 0);
-            ESP_LOGI(TAG, "MQTT> sent subscribe successful, msg_id=%d", msg_id);
-
-            break;
-        case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-            is_client_ready = false;
-            break;
-
-        case MQTT_EVENT_SUBSCRIBED:
-            break;
-        case MQTT_EVENT_UNSUBSCRIBED:
-            ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-            printf("MQTT> TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("MQTT> DATA=%.*s\r\n", event->data_len, event->data);
-            if(strncmp(event->topic,TOPIC_ALL,event->topic_len) == 0)
-            {
-                rgb_led_set_all(event->data,event->data_len);
-                ESP_LOGI(TAG, "MQTT> rgb all");
-            }
-            else if(strncmp(event->topic,TOPIC_LIST,event->topic_len) == 0)
-            {
-                rgb_led_set_list(event->data,event->data_len);
-                ESP_LOGI(TAG, "MQTT> rgb list");
-            }
-            else if(strncmp(event->topic,TOPIC_ONE,event->topic_len) == 0)
-            {
-                rgb_led_set_one(event->data,event->data_len);
-                ESP_LOGI(TAG, "MQTT> rgb one");
-            }
-            else
-            {
-                ESP_LOGI(TAG, "MQTT> unhandled topic len=%d", event->topic_len);
-            }
-            break;
-        case MQTT_EVENT_ERROR:
-            ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
-            break;
-    }
-    return ESP_OK;
+    topic_router_init(&router);
+    topic_router_add(&router, TOPIC_ALL,  &rgb_led_set_all);
+    topic_router_add(&router, TOPIC_LIST, &rgb_led_set_list);
+    topic_router_add(&router, TOPIC_ONE,  &rgb_led_set_one);
 }
 
-static esp_err_t wifi_event_handler(void *ctx, system_event_t *event)
+void publish_battery_voltage(uint32_t v_bat_mVolt)
 {
-    switch (event->event_id) {
-        case SYSTEM_EVENT_STA_START:
-            esp_wifi_connect();
-            break;
-        case SYSTEM_EVENT_STA_GOT_IP:
-            xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
-
-            break;
-        case SYSTEM_EVENT_STA_DISCONNECTED:
-            esp_wifi_connect();
-            xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
-            break;
-        default:
-            break;
+    telemetry_t doc;
+    if(telemetry_begin(&doc))
+    {
+        telemetry_add_int(&doc, "voltage_mv", v_bat_mVolt);
+        telemetry_add_uint(&doc, "uptime_s", (xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+        telemetry_publish(&doc, TOPIC_TELEMETRY, 1, 0);
     }
-    return ESP_OK;
+#if LEGACY_TOPICS
+    iot_publishf(TOPIC_BATTERY, 1, 0, "%u", v_bat_mVolt);
+#endif
 }
 
-static void wifi_init(void)
+//with the duty cycle, the wake count and the time from the wake to this publish
+bool publish_wake_telemetry(uint32_t v_bat_mVolt)
 {
-    tcpip_adapter_init();
-    wifi_event_group = xEventGroupCreate();
-    ESP_ERROR_CHECK(esp_event_loop_init(wifi_event_handler, NULL));
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    wifi_config_t wifi_config;
-    memset(&wifi_config,0,sizeof(wifi_config_t));
-    strcpy((char*)wifi_config.sta.ssid,CONFIG_WIFI_SSID);
-    strcpy((char*)wifi_config.sta.password,CONFIG_WIFI_PASSWORD);
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
-    ESP_LOGI(TAG, "start the WIFI SSID:[%s]", CONFIG_WIFI_SSID);
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "Waiting for wifi");
-    xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, false, true, portMAX_DELAY);
-}
-
-char mqtt_uri[32];
-char mqtt_lwt_topic[32];
-char mqtt_lwt_mesg[32];
-
-static void mqtt_app_start(void)
-{
-    esp_mqtt_client_config_t mqtt_cfg;
-    memset(&mqtt_cfg,0,sizeof(esp_mqtt_client_config_t));
-    strcpy(mqtt_uri,CONFIG_BROKER_URL);
-    strcpy(mqtt_lwt_topic,TOPIC_STATUS);
-    strcpy(mqtt_lwt_mesg,"offline");
-    mqtt_cfg.uri = mqtt_uri;
-    mqtt_cfg.event_handle = mqtt_event_handler;
-    mqtt_cfg.lwt_topic = mqtt_lwt_topic;
-    mqtt_cfg.lwt_msg = mqtt_lwt_mesg;
-    mqtt_cfg.lwt_msg_len = 1;
-    mqtt_cfg.lwt_retain = true;
-
-    g_client = esp_mqtt_client_init(&mqtt_cfg);
-    esp_mqtt_client_start(g_client);
-}
-
-void publish_battery_voltage(int v_bat_mVolt)
-{
-    if(is_client_ready)
+    telemetry_t doc;
+    if(!telemetry_begin(&doc))
     {
-        char payload[10];
-        sprintf(payload,"%d",v_bat_mVolt);
-        esp_mqtt_client_publish(g_client, TOPIC_BATTERY, payload, 0, 1, 0);
-    }
-    else
-    {
-        ESP_LOGW(TAG, "mqtt client not ready");
+        return false;
     }
+    telemetry_add_int(&doc, "voltage_mv", v_bat_mVolt);
+    telemetry_add_string(&doc, "wake", sleep_cycle_wake_name(sleep_cycle_wake_cause()));
+    telemetry_add_uint(&doc, "wake_ms", sleep_cycle_since_wake_ms());
+    telemetry_add_uint(&doc, "wakes", sleep_cycle_wakes());
+    telemetry_add_uint(&doc, "awake_s", sleep_cycle_awake_ms() / 1000);
+    telemetry_publish(&doc, TOPIC_TELEMETRY, 1, 0);
+#if LEGACY_TOPICS
+    iot_publishf(TOPIC_BATTERY, 1, 0, "%u", v_bat_mVolt);
+#endif
+    return true;
 }
 
+//the battery is measured by battery_monitor, this task only blinks the alive led
 void rgb_gpio_task(void *pvParameter)
 {
-    static int count = 0;
     gpio_pad_select_gpio(BLUE_LED);
     /* Set the GPIO as a push/pull output */
     gpio_set_direction(BLUE_LED, GPIO_MODE_OUTPUT);
@@ -286,14 +253,177 @@ void rgb_gpio_task(void *pvParameter)
         gpio_set_level(BLUE_LED, 1);
         vTaskDelay(10 / portTICK_PERIOD_MS);
         gpio_set_level(BLUE_LED, 0);
+        battery_monitor_led_activity();
         vTaskDelay(990 / portTICK_PERIOD_MS);
-        if((count++ %(10*60)) == 0)
+    }
+}
+
+void battery_init()
+{
+    adc_cal_lut_init(&adc_lut, &adc_chars);
+    battery_monitor_config_t config;
+    config.read_raw = &adc_read_raw;
+    config.raw_to_mv = &adc_raw_to_mv;
+    config.on_change = &publish_battery_voltage;
+    config.period_ms = 10000;
+    config.threshold_mv = 20;
+    config.heartbeat_s = 10*60;
+    battery_monitor_init(&config);
+}
+
+static apds9960_t gesture_sensor;
+static SemaphoreHandle_t gesture_mutex = NULL;     //created once the sensor answered
+
+//INT is released when the FIFO is read, it stays low if a read failed or if more
+//datasets came than a service reads, it is then serviced again, and as the interrupt
+//is on the falling edge, the sensor is configured again if it is still held after that
+#define GESTURE_SERVICE_ROUNDS  16
+#define GESTURE_RETRY_MS        10
+
+//INT is open drain active low, a digital input again after sleep_cycle_init()
+void gesture_int_input()
+{
+    gpio_pad_select_gpio(GESTURE_INT_GPIO);
+    gpio_set_direction(GESTURE_INT_GPIO, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(GESTURE_INT_GPIO, GPIO_PULLUP_ONLY);
+}
+
+bool gesture_int_held()
+{
+    return (gesture_mutex != NULL) && (gpio_get_level(GESTURE_INT_GPIO) == 0);
+}
+
+void gesture_publish(apds9960_gesture_t gesture, int64_t int_time_us)
+{
+    sleep_cycle_activity();
+    xEventGroupWaitBits(iot_event_group, IOT_MQTT_CONNECTED_BIT, false, true, CONNECT_TIMEOUT_MS / portTICK_PERIOD_MS);
+    int64_t latency_us = esp_timer_get_time() - int_time_us;
+    telemetry_t doc;
+    if(telemetry_begin(&doc))
+    {
+        telemetry_add_string(&doc, "gesture", apds9960_gesture_name(gesture));
+        telemetry_add_uint(&doc, "latency_us", (uint32_t)latency_us);
+        telemetry_publish(&doc, TOPIC_GESTURE, 1, 0);
+    }
+    LOG_RING_I(TAG, "gesture> %d after %u us (%u datasets)", gesture, (uint32_t)latency_us, gesture_sensor.datasets);
+}
+
+//runs in the gpio_events task, and from gesture_init() for an INT already low when the
+//interrupt was armed, the latency is taken from the interrupt that ended the gesture,
+//after a wake by the sensor it includes the connection
+void gesture_on_int(const gpio_event_t *event, void *arg)
+{
+    if(gesture_mutex == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(gesture_mutex, portMAX_DELAY);
+    for(int round=0;round<GESTURE_SERVICE_ROUNDS;round++)
+    {
+        apds9960_gesture_t gesture;
+        if(apds9960_service(&gesture_sensor, &gesture) && (gesture != APDS9960_GESTURE_NONE))
+        {
+            gesture_publish(gesture, event->time_us);
+        }
+        if(gpio_get_level(GESTURE_INT_GPIO) != 0)
         {
-            uint32_t v_bat = adc_read();
-            publish_battery_voltage(v_bat);
-            ESP_LOGI(TAG, "v Bat measure %d mV", v_bat);
+            xSemaphoreGive(gesture_mutex);
+            return;
         }
+        vTaskDelay(GESTURE_RETRY_MS / portTICK_PERIOD_MS);
+    }
+    //the init clears the FIFO and the interrupt
+    apds9960_bus_t bus = gesture_sensor.bus;
+    uint32_t bus_errors = gesture_sensor.bus_errors;
+    bool restarted = apds9960_init(&gesture_sensor, &bus);
+    LOG_RING_I(TAG, "gesture> INT held, sensor restarted %d (%u bus errors)", restarted, bus_errors);
+    xSemaphoreGive(gesture_mutex);
+}
+
+void gesture_init()
+{
+    apds9960_bus_t bus;
+    if(!apds9960_i2c_init(I2C_NUM_0, GESTURE_SDA_GPIO, GESTURE_SCL_GPIO, &bus))
+    {
+        return;
+    }
+    //pulled up before its interrupt is armed
+    gesture_int_input();
+    //after a deep sleep the sensor kept running, its FIFO holds the gesture that woke the node
+    bool resumed = (sleep_cycle_wake_cause() != SLEEP_WAKE_POWER_ON) && apds9960_resume(&gesture_sensor, &bus);
+    if(!resumed && !apds9960_init(&gesture_sensor, &bus))
+    {
+        ESP_LOGE(TAG, "APDS-9960 not found");
+        return;
+    }
+    gesture_mutex = xSemaphoreCreateMutex();
+    gpio_events_init();
+    gpio_events_add(GESTURE_INT_GPIO, GPIO_INTR_NEGEDGE, 0, &gesture_on_int, NULL);
+    if(gpio_get_level(GESTURE_INT_GPIO) == 0)
+    {
+        //the edge was before the interrupt, after a wake it is taken at the wake
+        gpio_event_t early_event = {resumed ? 0 : esp_timer_get_time(), (uint8_t)GESTURE_INT_GPIO, 0};
+        gesture_on_int(&early_event, NULL);
+    }
+    ESP_LOGI(TAG, "APDS-9960 gesture mode %s", resumed ? "resumed" : "started");
+}
+
+//the filter and the last published value are kept in RTC memory over the deep sleeps
+static RTC_DATA_ATTR battery_filter_t battery_filter;
+static RTC_DATA_ATTR uint32_t battery_published_mv;
+static RTC_DATA_ATTR uint32_t battery_timer_wakes;
+
+uint32_t battery_measure()
+{
+    if(sleep_cycle_wake_cause() == SLEEP_WAKE_POWER_ON)
+    {
+        battery_filter_init(&battery_filter);
+        battery_published_mv = 0;
+        battery_timer_wakes = HEARTBEAT_WAKES;
     }
+    uint16_t samples[BATTERY_BURST_SAMPLES];
+    for(int i=0;i<BATTERY_BURST_SAMPLES;i++)
+    {
+        samples[i] = adc_read_raw();
+    }
+    uint16_t filtered = battery_filter_push(&battery_filter, battery_burst_reduce(samples, BATTERY_BURST_SAMPLES));
+    return adc_raw_to_mv(filtered);
+}
+
+void duty_cycle_sleep()
+{
+    sleep_cycle_deep_sleep(SLEEP_PERIOD_S, GESTURE_INT_GPIO, 0);
+}
+
+//a timer wake with a stable battery goes back to sleep without starting the radio
+bool duty_cycle_needs_radio(uint32_t v_bat_mVolt)
+{
+    if(sleep_cycle_wake_cause() != SLEEP_WAKE_TIMER)
+    {
+        return true;
+    }
+    battery_timer_wakes++;
+    gesture_int_input();
+    uint32_t delta = (v_bat_mVolt > battery_published_mv) ? (v_bat_mVolt - battery_published_mv) : (battery_published_mv - v_bat_mVolt);
+    return (delta >= 20) || (battery_timer_wakes >= HEARTBEAT_WAKES) || (gpio_get_level(GESTURE_INT_GPIO) == 0);
+}
+
+void duty_cycle_task(void *pvParameter)
+{
+    uint32_t v_bat = (uint32_t)(intptr_t)pvParameter;
+    xEventGroupWaitBits(iot_event_group, IOT_MQTT_CONNECTED_BIT, false, true, CONNECT_TIMEOUT_MS / portTICK_PERIOD_MS);
+    if(publish_wake_telemetry(v_bat))
+    {
+        battery_published_mv = v_bat;
+        battery_timer_wakes = 0;
+        boot_timeline_mark("telemetry published");
+    }
+    //the commands queued in the session arrive after the connection, and the sensor must release INT
+    while((sleep_cycle_idle_ms() < AWAKE_IDLE_MS) || gesture_int_held())
+    {
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
+    duty_cycle_sleep();
 }
 
 void show_pixels(uint8_t r,uint8_t g,uint8_t b)
@@ -303,6 +433,7 @@ void show_pixels(uint8_t r,uint8_t g,uint8_t b)
         my_rgb.setPixel(i,r,g,b);    
     }
     my_rgb.show();
+    leds_changed();
 }
 
 
@@ -311,6 +442,7 @@ extern "C" void app_main();
 void app_main()
 {
     ESP_LOGI(TAG, "[APP] Startup..");
+    log_ring_init();
     ESP_LOGI(TAG, "[APP] Free memory: %d bytes", esp_get_free_heap_size());
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
 
@@ -322,16 +454,55 @@ void app_main()
     esp_log_level_set("OUTBOX", ESP_LOG_VERBOSE);
 
     nvs_flash_init();
-    wifi_init();
+    sleep_cycle_init();
+
+#if DUTY_CYCLE
+    //the battery is measured before the radio is started, which may not be needed
     adc_init();
+    uint32_t v_bat = battery_measure();
+    if(!duty_cycle_needs_radio(v_bat))
+    {
+        duty_cycle_sleep();
+    }
+    mqtt_routes_init();
+    iot_wifi_init();
+    iot_mqtt_persistent_session();
+    iot_mqtt_start(TOPIC_STATUS, TOPIC_SUB, &router);
+    gesture_init();
+    xTaskCreate(&duty_cycle_task, "duty_cycle_task", 3072, (void *)(intptr_t)v_bat, 5, NULL);
+    boot_timeline_mark("gesture ready");
+    if(sleep_cycle_wake_cause() != SLEEP_WAKE_POWER_ON)
+    {
+        //the leds kept their colors over the sleep
+        return;
+    }
+#else
+    mqtt_routes_init();
+    iot_wifi_init();
+    iot_mqtt_start(TOPIC_STATUS, TOPIC_SUB, &router);
 
+    //the ADC and the leds do not depend on the network, set up while the station associates
+    adc_init();
+    battery_init();
     xTaskCreate(&rgb_gpio_task, "rgb_gpio_task", 2048, NULL, 5, NULL);
+    boot_timeline_mark("adc ready");
+    gesture_init();
+    boot_timeline_mark("gesture ready");
+#endif
 
-    mqtt_app_start();
-
-    show_pixels(25,4,0);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    show_pixels(4,25,2);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    show_pixels(2,4,20);
+    //stopped by the first command so that it is not overwritten
+    if(iot_boot_begin())
+    {
+        show_pixels(25,4,0);
+        if(iot_boot_delay_ms(500))
+        {
+            show_pixels(4,25,2);
+            if(iot_boot_delay_ms(500))
+            {
+                show_pixels(2,4,20);
+                iot_boot_end();
+            }
+        }
+    }
+    boot_timeline_mark("leds self-test");
 }
@@ -0,0 +1,6 @@
+#
+# main component makefile.
+#
+# the ArduinoJson fork of rgb_led, with SizedJson, the arena buffer and MessagePack
+
+COMPONENT_ADD_INCLUDEDIRS := . ../../rgb_led/ArduinoJson
@@ -0,0 +1,143 @@
+// Runs temp_control.c and heater.c on a thermal model of the bed
+//
+// The model is first order, 20 C ambient, 80 C at full power with a 600 s
+// time constant, and the NTC follows the bed with a 40 s lag. It is not
+// measured on the bed, it only gives the control a slow plant with a delay to
+// work against. The control is sampled every heater period as in
+// control_timer_cb() of app_main.c, and the duty is given for two periods.
+
+#include "heater.h"
+#include "temp_control.h"
+#include "host_test.h"
+
+#define STEP_MS         100
+#define AMBIENT_C       20.0
+#define FULL_POWER_C    60.0    //over the ambient
+#define TAU_S           600.0
+#define SENSOR_LAG_S    40.0
+
+typedef struct {
+    double  bed;
+    double  sensor;
+} plant_t;
+
+static void plant_step(plant_t *plant, bool on)
+{
+    double dt = STEP_MS / 1000.0;
+    double steady = AMBIENT_C + (on ? FULL_POWER_C : 0.0);
+    plant->bed += dt * (steady - plant->bed) / TAU_S;
+    plant->sensor += dt * (plant->bed - plant->sensor) / SENSOR_LAG_S;
+}
+
+typedef struct {
+    double  final_c;
+    double  overshoot_c;
+    int     tuned_s;        //-1 if not tuned
+    int     settled_s;      //last time out of the 0.5 C band, after the tuning
+} run_result_t;
+
+static void run(temp_control_t *control, bool autotune, int32_t target, int seconds, run_result_t *result)
+{
+    plant_t plant = {AMBIENT_C, AMBIENT_C};
+    heater_t heater;
+    heater_init(&heater);
+    if(autotune)
+    {
+        temp_control_autotune(control, target);
+    }
+    else
+    {
+        temp_control_set_target(control, target);
+    }
+    result->tuned_s = -1;
+    result->overshoot_c = -1000;
+    result->settled_s = 0;
+    int64_t deadline = HEATER_NO_DEADLINE;
+    for(int64_t t=0;t<(int64_t)seconds*1000;t+=STEP_MS)
+    {
+        if(t % HEATER_PERIOD_MS == 0)
+        {
+            temp_control_mode_t mode = control->mode;
+            int duty = temp_control_step(control, (int32_t)(plant.sensor * 100));
+            if((mode == TEMP_CONTROL_AUTOTUNE) && (control->mode == TEMP_CONTROL_PID))
+            {
+                result->tuned_s = t / 1000;
+            }
+            heater_set_duty(&heater, duty, 2 * HEATER_PERIOD_MS / 1000, t);
+            deadline = heater_update(&heater, t);
+        }
+        if(t >= deadline)
+        {
+            deadline = heater_update(&heater, t);
+        }
+        plant_step(&plant, heater.on);
+        if(!autotune || (result->tuned_s >= 0))
+        {
+            double error = plant.sensor - target / 100.0;
+            if(error > result->overshoot_c)
+            {
+                result->overshoot_c = error;
+            }
+            if((error > 0.5) || (error < -0.5))
+            {
+                result->settled_s = t / 1000;
+            }
+        }
+    }
+    result->final_c = plant.sensor;
+}
+
+int main(void)
+{
+    const temp_gains_t default_gains = {65536, 655, 0};     //as in app_main.c
+    temp_control_t control;
+    run_result_t result;
+
+    temp_control_init(&control, &default_gains);
+    run(&control, false, 4500, 2 * 3600, &result);
+    printf("default gains: %.2f C after 2 h, overshoot %.2f C, in the band after %d s\n",
+            result.final_c, result.overshoot_c, result.settled_s);
+    CHECK((result.final_c > 44.5) && (result.final_c < 45.5));
+    CHECK(result.overshoot_c < 0.5);
+
+    temp_control_init(&control, &default_gains);
+    run(&control, true, 4500, 3 * 3600, &result);
+    printf("autotune: tuned after %d s, kp %d ki %d kd %d\n", result.tuned_s,
+            control.gains.kp, control.gains.ki, control.gains.kd);
+    printf("autotuned gains: %.2f C after 3 h, overshoot %.2f C, in the band %d s after the tuning\n",
+            result.final_c, result.overshoot_c, result.settled_s - result.tuned_s);
+    CHECK(result.tuned_s > 0);
+    CHECK(control.mode == TEMP_CONTROL_PID);
+    CHECK((control.gains.kp > 0) && (control.gains.ki > 0) && (control.gains.kd > 0));
+    CHECK((result.final_c > 44.5) && (result.final_c < 45.5));
+    CHECK(result.overshoot_c < 0.5);
+    CHECK(result.settled_s - result.tuned_s <= 120);
+
+    //the nearest fixed level, 4 s of each 10 s period, without the control
+    plant_t plant = {AMBIENT_C, AMBIENT_C};
+    heater_t heater;
+    heater_init(&heater);
+    heater_request(&heater, 4, 2 * 3600, 0);
+    int64_t deadline = heater_update(&heater, 0);
+    for(int64_t t=0;t<2*3600*1000;t+=STEP_MS)
+    {
+        if(t >= deadline)
+        {
+            deadline = heater_update(&heater, t);
+        }
+        plant_step(&plant, heater.on);
+    }
+    printf("level 4 open loop: %.2f C after 2 h\n", plant.sensor);
+    CHECK((plant.sensor < 44.5) || (plant.sensor > 45.5));
+
+    //the cut, whatever the mode
+    temp_control_init(&control, &default_gains);
+    temp_control_set_target(&control, 4500);
+    CHECK(temp_control_step(&control, 2000) > 0);
+    CHECK(temp_control_step(&control, INT32_MIN) == 0);
+    CHECK(temp_control_step(&control, TEMP_CONTROL_MAX_C100 + 1) == 0);
+    temp_control_autotune(&control, 4500);
+    CHECK(temp_control_step(&control, INT32_MIN) == 0);
+    CHECK(temp_control_step(&control, TEMP_CONTROL_MAX_C100 + 1) == 0);
+    return host_test_result();
+}
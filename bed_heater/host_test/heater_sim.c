@@ -0,0 +1,159 @@
+// Drives heater.c with a simulated one shot timer and relay output
+//
+// As in app_main.c, every change of the request is followed by an apply that
+// calls heater_update(), sets the output and restarts the timer at the
+// returned deadline, and the timer callback applies again. The relay on time
+// is integrated from the output and compared to heater_on_ms().
+
+#include "heater.h"
+#include "host_test.h"
+
+typedef struct {
+    heater_t    heater;
+    int64_t     now_ms;
+    int64_t     timer_ms;       //HEATER_NO_DEADLINE when stopped
+    bool        relay;
+    int64_t     relay_since_ms;
+    int64_t     relay_on_ms;
+    int         switches;
+} sim_t;
+
+static void sim_init(sim_t *sim)
+{
+    heater_init(&sim->heater);
+    sim->now_ms = 0;
+    sim->timer_ms = HEATER_NO_DEADLINE;
+    sim->relay = false;
+    sim->relay_since_ms = 0;
+    sim->relay_on_ms = 0;
+    sim->switches = 0;
+}
+
+static int64_t relay_on_ms(const sim_t *sim)
+{
+    return sim->relay_on_ms + (sim->relay ? sim->now_ms - sim->relay_since_ms : 0);
+}
+
+//heater_apply() of app_main.c
+static void sim_apply(sim_t *sim)
+{
+    int64_t deadline = heater_update(&sim->heater, sim->now_ms);
+    if(sim->heater.on != sim->relay)
+    {
+        if(sim->relay)
+        {
+            sim->relay_on_ms += sim->now_ms - sim->relay_since_ms;
+        }
+        sim->relay_since_ms = sim->now_ms;
+        sim->relay = sim->heater.on;
+        sim->switches++;
+    }
+    CHECK(deadline > sim->now_ms);
+    sim->timer_ms = deadline;
+    CHECK(heater_on_ms(&sim->heater, sim->now_ms) == relay_on_ms(sim));
+}
+
+//fires the timer at each deadline up to the time
+static void sim_run_until(sim_t *sim, int64_t time_ms)
+{
+    while(sim->timer_ms <= time_ms)
+    {
+        sim->now_ms = sim->timer_ms;
+        sim_apply(sim);
+    }
+    sim->now_ms = time_ms;
+}
+
+static void check_level(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    sim_run_until(&sim, 1000);
+    heater_request(&sim.heater, 4, 60, sim.now_ms);
+    sim_apply(&sim);
+    CHECK(sim.relay);
+    CHECK(heater_periods_left(&sim.heater, sim.now_ms) == 6);
+    sim_run_until(&sim, 5000);
+    CHECK(!sim.relay);
+    sim_run_until(&sim, 100000);
+    //6 periods of 4 s, then idle
+    CHECK(relay_on_ms(&sim) == 24000);
+    CHECK(sim.switches == 12);
+    CHECK(sim.timer_ms == HEATER_NO_DEADLINE);
+    CHECK(heater_level(&sim.heater, sim.now_ms) == 0);
+    printf("level 4 for 60 s: %lld ms on, %d switches\n", (long long)relay_on_ms(&sim), sim.switches);
+}
+
+static void check_new_request(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    heater_request(&sim.heater, 4, 60, sim.now_ms);
+    sim_apply(&sim);
+    //in the off part of the third period, the new level starts its period at once
+    sim_run_until(&sim, 25500);
+    CHECK(!sim.relay);
+    heater_request(&sim.heater, 7, 30, sim.now_ms);
+    sim_apply(&sim);
+    CHECK(sim.relay);
+    CHECK(heater_level(&sim.heater, sim.now_ms) == 7);
+    sim_run_until(&sim, 100000);
+    CHECK(relay_on_ms(&sim) == 3 * 4000 + 3 * 7000);
+    //stopped in the on part of a period
+    heater_request(&sim.heater, 5, 60, sim.now_ms);
+    sim_apply(&sim);
+    sim_run_until(&sim, sim.now_ms + 2000);
+    heater_request(&sim.heater, 0, 0, sim.now_ms);
+    sim_apply(&sim);
+    CHECK(!sim.relay);
+    CHECK(relay_on_ms(&sim) == 33000 + 2000);
+    CHECK(sim.timer_ms == HEATER_NO_DEADLINE);
+    printf("request replaced in a period: %lld ms on\n", (long long)relay_on_ms(&sim));
+}
+
+static void check_full_level(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    heater_request(&sim.heater, HEATER_MAX_LEVEL + 5, 25, sim.now_ms);
+    sim_apply(&sim);
+    sim_run_until(&sim, 60000);
+    //one pulse, the relay is not released between the periods
+    CHECK(relay_on_ms(&sim) == 25000);
+    CHECK(sim.switches == 2);
+    printf("full level for 25 s: %lld ms on, %d switches\n", (long long)relay_on_ms(&sim), sim.switches);
+}
+
+static void check_duty(void)
+{
+    sim_t sim;
+    sim_init(&sim);
+    //the control renews a duty for two periods at each sample
+    heater_set_duty(&sim.heater, 500, 2 * HEATER_PERIOD_MS / 1000, sim.now_ms);
+    sim_apply(&sim);
+    sim_run_until(&sim, 3000);
+    CHECK(sim.relay);
+    //a lower duty moves the off edge of the running period, already passed
+    heater_set_duty(&sim.heater, 200, 2 * HEATER_PERIOD_MS / 1000, sim.now_ms);
+    sim_apply(&sim);
+    CHECK(!sim.relay);
+    CHECK(relay_on_ms(&sim) == 3000);
+    sim_run_until(&sim, 10000);
+    heater_set_duty(&sim.heater, 750, 2 * HEATER_PERIOD_MS / 1000, sim.now_ms);
+    sim_apply(&sim);
+    CHECK(sim.relay);
+    //the control stops renewing, the heater stops at the end of the second period
+    sim_run_until(&sim, 60000);
+    CHECK(relay_on_ms(&sim) == 3000 + 2 * 7500);
+    CHECK(sim.timer_ms == HEATER_NO_DEADLINE);
+    printf("duty changes then no sample: %lld ms on\n", (long long)relay_on_ms(&sim));
+}
+
+int main(void)
+{
+    check_level();
+    check_new_request();
+    check_full_level();
+    check_duty();
+    return host_test_result();
+}
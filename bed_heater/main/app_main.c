@@ -17,22 +17,57 @@
 #include "lwip/dns.h"
 #include "lwip/netdb.h"
 
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
+#include "iot_core.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "adc_cal_lut.h"
 
-static const char *TAG = "MQTT_EXAMPLE";
-
-static EventGroupHandle_t wifi_event_group;
-const static int CONNECTED_BIT = BIT0;
+#include "heater.h"
+#include "ntc.h"
+#include "temp_control.h"
 
-esp_mqtt_client_handle_t g_client;
-bool is_client_ready = false;
+static const char *TAG = "MQTT_EXAMPLE";
+static const char* TOPIC_HEAT_1H = "esp/bed heater/1h";
+static const char* TOPIC_TARGET  = "esp/bed heater/target";
+static const char* TOPIC_AUTOTUNE = "esp/bed heater/autotune";
+static const char* TOPIC_SUB     = "esp/bed heater/#";
+static const char* TOPIC_STATUS  = "esp/bed heater/status";
+static const char* TOPIC_TELEMETRY = "esp/bed heater/telemetry";
+//the single value topics of the previous versions, published next to the telemetry
+//until their subscribers read the document, 0 to drop them
+#define LEGACY_TOPICS 1
+#if LEGACY_TOPICS
+static const char* TOPIC_HEATING = "esp/bed heater/heating";
+static const char* TOPIC_TIMER   = "esp/bed heater/timer";
+#endif
 
 #define BLUE_LED 2
 #define HEATER_GPIO 15
 
-int heat_request = 0;
-int heat_timer = 0;
+//10k B3950 NTC to the ground, 10k pull-up to 3.3 V, middle point on GPIO34
+#define DEFAULT_VREF    1100
+static const adc1_channel_t ntc_channel = ADC1_CHANNEL_6;
+static esp_adc_cal_characteristics_t adc_chars;
+static adc_cal_lut_t adc_lut;
+static ntc_t ntc;
+
+//conservative until an autotune : 10 % per degree, 0.1 % per degree and per sample
+static const temp_gains_t default_gains = {65536, 655, 0};
+
+//shared by the MQTT handler, the esp_timer task and the status task
+static heater_t heater;
+static SemaphoreHandle_t heater_mutex = NULL;
+static esp_timer_handle_t heater_timer = NULL;
+static TaskHandle_t heater_status_task_handle = NULL;
+static temp_control_t control;
+static int32_t temperature = NTC_INVALID;
+static esp_timer_handle_t control_timer = NULL;
 
 int atoi_n(const char * str,int len)
 {
@@ -46,185 +81,272 @@ int atoi_n(const char * str,int len)
     return atoi(str_end_0);
 }
 
-int set_heat_1h(const char * payload,int len)
+//temperature in centi-degrees with up to 2 decimals, "45" or "45.5"
+int32_t atoc100_n(const char * str,int len)
 {
-    heat_request = atoi_n(payload,len);
-    heat_timer = 6*60;// 1h
-    return heat_request;
+    int32_t value = 0;
+    int decimals = -1;
+    bool negative = false;
+    if(len > 10)
+    {
+        len = 10;
+    }
+    for(int i=0;i<len;i++)
+    {
+        char c = str[i];
+        if((c == '-') && (i == 0))
+        {
+            negative = true;
+        }
+        else if((c == '.') && (decimals < 0))
+        {
+            decimals = 0;
+        }
+        else if((c >= '0') && (c <= '9') && (decimals < 2))
+        {
+            value = value * 10 + (c - '0');
+            if(decimals >= 0)
+            {
+                decimals++;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    for(int i=(decimals < 0) ? 0 : decimals;i<2;i++)
+    {
+        value *= 10;
+    }
+    return negative ? -value : value;
 }
 
-static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
+static int64_t now_ms()
 {
-    g_client = event->client;//update g_client
-    int msg_id;
-    // your_context_t *context = event->context;
-    switch (event->event_id) {
-        case MQTT_EVENT_CONNECTED:
-            is_client_ready = true;
-            ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
-            msg_id = esp_mqtt_client_publish(g_client, "esp/bed heater/status", "online", 0, 1, 1);
-            ESP_LOGI(TAG, "MQTT> sent publish successful, msg_id=%d", msg_id);
+    return esp_timer_get_time() / 1000;
+}
 
-            msg_id = esp_mqtt_client_subscribe(g_client, "esp/bed heater/1h", 0);
-            ESP_LOGI(TAG, "MQTT> sent subscribe successful, msg_id=%d", msg_id);
+//called with the mutex, applies the output and schedules the next change
+static void heater_apply()
+{
+    int64_t now = now_ms();
+    bool was_on = heater.on;
+    int64_t deadline = heater_update(&heater, now);
+    gpio_set_level(HEATER_GPIO, heater.on);
+    gpio_set_level(BLUE_LED, heater.on);
+    if(heater.on != was_on)
+    {
+        LOG_RING_I(TAG, "heater> output %d", heater.on);
+    }
+    esp_timer_stop(heater_timer);
+    if(deadline != HEATER_NO_DEADLINE)
+    {
+        esp_timer_start_once(heater_timer, (deadline - now) * 1000);
+    }
+}
 
-            break;
-        case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-            is_client_ready = false;
-            break;
+static void heater_timer_cb(void *arg)
+{
+    xSemaphoreTake(heater_mutex, portMAX_DELAY);
+    heater_apply();
+    xSemaphoreGive(heater_mutex);
+}
 
-        case MQTT_EVENT_SUBSCRIBED:
-            break;
-        case MQTT_EVENT_UNSUBSCRIBED:
-            ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-            printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("DATA=%.*s\r\n", event->data_len, event->data);
-            if(strncmp(event->topic,"esp/bed heater/1h",event->topic_len) == 0)
-            {
-                int heat = set_heat_1h(event->data,event->data_len);
-                ESP_LOGI(TAG, "MQTT> heat request 1h at %d", heat);
-            }
-            else
-            {
-                ESP_LOGI(TAG, "MQTT> unhandled topic %s", event->topic);
-            }
-            break;
-        case MQTT_EVENT_ERROR:
-            ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
-            break;
+int32_t ntc_read_c100()
+{
+    uint32_t sum = 0;
+    for(int i=0;i<16;i++)
+    {
+        sum += adc1_get_raw(ntc_channel);
     }
-    return ESP_OK;
+    return ntc_mv_to_c100(&ntc, adc_cal_lut_to_mv(&adc_lut, (sum + 8) / 16));
 }
 
-static esp_err_t wifi_event_handler(void *ctx, system_event_t *event)
+//once per heater period, the duty is given for two periods so that the heater stops if the control does,
+//the temperature is read in every mode so that a manual request is also cut on a fault or over heat
+static void control_timer_cb(void *arg)
 {
-    switch (event->event_id) {
-        case SYSTEM_EVENT_STA_START:
-            esp_wifi_connect();
-            break;
-        case SYSTEM_EVENT_STA_GOT_IP:
-            xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
+    int32_t temp = ntc_read_c100();
+    xSemaphoreTake(heater_mutex, portMAX_DELAY);
+    temperature = temp;
+    temp_control_mode_t mode = control.mode;
+    bool cut = false;
+    if(mode != TEMP_CONTROL_OFF)
+    {
+        int duty = temp_control_step(&control, temp);
+        heater_set_duty(&heater, duty, 2 * HEATER_PERIOD_MS / 1000, now_ms());
+        heater_apply();
+    }
+    else if(((temp == NTC_INVALID) || (temp > TEMP_CONTROL_MAX_C100)) && (heater_level(&heater, now_ms()) != 0))
+    {
+        //the manual request has no control, the cut of temp_control_step() is done here
+        heater_request(&heater, 0, 0, now_ms());
+        heater_apply();
+        cut = true;
+    }
+    bool tuned = (mode == TEMP_CONTROL_AUTOTUNE) && (control.mode == TEMP_CONTROL_PID);
+    temp_gains_t gains = control.gains;
+    xSemaphoreGive(heater_mutex);
+    if(cut)
+    {
+        LOG_RING_I(TAG, "heater> request cut at %d centi-degrees", temp);
+        xTaskNotifyGive(heater_status_task_handle);
+    }
+    if(tuned)
+    {
+        ESP_LOGI(TAG, "autotune> kp %d ki %d kd %d (Q16 permille per centi-degree)", gains.kp, gains.ki, gains.kd);
+        xTaskNotifyGive(heater_status_task_handle);
+    }
+}
 
-            break;
-        case SYSTEM_EVENT_STA_DISCONNECTED:
-            esp_wifi_connect();
-            xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
-            break;
-        default:
-            break;
+void set_heat_1h(char * payload,int len)
+{
+    int level = atoi_n(payload,len);
+    xSemaphoreTake(heater_mutex, portMAX_DELAY);
+    temp_control_off(&control);
+    heater_request(&heater, level, 60*60, now_ms());
+    heater_apply();
+    xSemaphoreGive(heater_mutex);
+    xTaskNotifyGive(heater_status_task_handle);
+    LOG_RING_I(TAG, "MQTT> heat request 1h at %d", level);
+}
+
+//the first duty is applied at the next control sample, within a heater period
+void set_target(char * payload,int len)
+{
+    int32_t target = atoc100_n(payload,len);
+    xSemaphoreTake(heater_mutex, portMAX_DELAY);
+    temp_control_set_target(&control, target);
+    if(control.mode == TEMP_CONTROL_OFF)
+    {
+        heater_request(&heater, 0, 0, now_ms());
+        heater_apply();
     }
-    return ESP_OK;
-}
-
-static void wifi_init(void)
-{
-    tcpip_adapter_init();
-    wifi_event_group = xEventGroupCreate();
-    ESP_ERROR_CHECK(esp_event_loop_init(wifi_event_handler, NULL));
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = CONFIG_WIFI_SSID,
-            .password = CONFIG_WIFI_PASSWORD,
-        },
-    };
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
-    ESP_LOGI(TAG, "start the WIFI SSID:[%s]", CONFIG_WIFI_SSID);
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "Waiting for wifi");
-    xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, false, true, portMAX_DELAY);
+    xSemaphoreGive(heater_mutex);
+    xTaskNotifyGive(heater_status_task_handle);
+    LOG_RING_I(TAG, "MQTT> target %d centi-degrees", target);
 }
 
-static void mqtt_app_start(void)
+void set_autotune(char * payload,int len)
 {
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .uri = CONFIG_BROKER_URL,
-        .event_handle = mqtt_event_handler,
-        // .user_context = (void *)your_context
-    };
+    int32_t target = atoc100_n(payload,len);
+    xSemaphoreTake(heater_mutex, portMAX_DELAY);
+    temp_control_autotune(&control, target);
+    xSemaphoreGive(heater_mutex);
+    xTaskNotifyGive(heater_status_task_handle);
+    LOG_RING_I(TAG, "MQTT> autotune around %d centi-degrees", target);
+}
 
-    g_client = esp_mqtt_client_init(&mqtt_cfg);
-    esp_mqtt_client_start(g_client);
+topic_router_t router;
+
+void mqtt_routes_init()
+{
+    topic_router_init(&router);
+    topic_router_add(&router, TOPIC_HEAT_1H, &set_heat_1h);
+    topic_router_add(&router, TOPIC_TARGET, &set_target);
+    topic_router_add(&router, TOPIC_AUTOTUNE, &set_autotune);
 }
 
-void publish_heat_status(int heat,int timer)
+static const char *mode_name(temp_control_mode_t mode)
 {
-    if(is_client_ready)
+    switch(mode)
     {
-        char payload[10];
-        sprintf(payload,"%d",heat);
-        int msg_id = esp_mqtt_client_publish(g_client, "esp/bed heater/heating", payload, 0, 1, 0);
-        ESP_LOGD(TAG, "heater> sent publish successful, msg_id=%d", msg_id);
-        sprintf(payload,"%d",timer);
-        msg_id = esp_mqtt_client_publish(g_client, "esp/bed heater/timer", payload, 0, 1, 0);
-        ESP_LOGD(TAG, "heater> sent publish successful, msg_id=%d", msg_id);
+        case TEMP_CONTROL_PID:      return "pid";
+        case TEMP_CONTROL_AUTOTUNE: return "autotune";
+        default:                    return "manual";
     }
-    else
+}
+
+void publish_heat_status(int heat,int timer,int64_t on_ms,int32_t temp,const temp_control_t *ctrl)
+{
+    telemetry_t doc;
+    if(telemetry_begin(&doc))
     {
-        ESP_LOGW(TAG, "mqtt client not ready");
+        telemetry_add_int(&doc, "heating", heat);
+        telemetry_add_int(&doc, "timer", timer);
+        telemetry_add_uint(&doc, "on_s", (uint32_t)(on_ms / 1000));
+        if(temp != NTC_INVALID)
+        {
+            telemetry_add_fixed(&doc, "temp", temp, 2);
+        }
+        telemetry_add_string(&doc, "mode", mode_name(ctrl->mode));
+        if(ctrl->mode != TEMP_CONTROL_OFF)
+        {
+            telemetry_add_fixed(&doc, "target", ctrl->target, 2);
+            telemetry_add_int(&doc, "duty", ctrl->duty);
+        }
+        int msg_id = telemetry_publish(&doc, TOPIC_TELEMETRY, 1, 0);
+        ESP_LOGD(TAG, "heater> sent publish successful, msg_id=%d", msg_id);
     }
+#if LEGACY_TOPICS
+    iot_publishf(TOPIC_HEATING, 1, 0, "%d", heat);
+    iot_publishf(TOPIC_TIMER, 1, 0, "%d", timer);
+#endif
 }
 
-void heater_gpio_task(void *pvParameter)
+//the relay is switched by the esp_timer, this task only reports, every period while heating
+void heater_status_task(void *pvParameter)
+{
+    while(1) {
+        xSemaphoreTake(heater_mutex, portMAX_DELAY);
+        int64_t now = now_ms();
+        int level = heater_level(&heater, now);
+        uint32_t periods = heater_periods_left(&heater, now);
+        int64_t on_ms = heater_on_ms(&heater, now);
+        int32_t temp = temperature;
+        temp_control_t ctrl = control;
+        xSemaphoreGive(heater_mutex);
+        publish_heat_status(level, periods, on_ms, temp, &ctrl);
+        ulTaskNotifyTake(pdTRUE, (level > 0 ? HEATER_PERIOD_MS : 2*HEATER_PERIOD_MS) / portTICK_PERIOD_MS);
+    }
+}
+
+void heater_init_outputs()
 {
     gpio_pad_select_gpio(BLUE_LED);
     gpio_pad_select_gpio(HEATER_GPIO);
     /* Set the GPIO as a push/pull output */
     gpio_set_direction(HEATER_GPIO, GPIO_MODE_OUTPUT);
     gpio_set_direction(BLUE_LED, GPIO_MODE_OUTPUT);
-    static int loop_i=0;
-    while(1) {
-        ESP_LOGI(TAG, "heater> loop %d", loop_i++);
-        if( (heat_request > 0) && (heat_timer > 0) )
-        {
-            int heat_value = heat_request;
-            if(heat_value > 10)
-            {
-                heat_value = 10;
-            }
-            publish_heat_status(heat_value,heat_timer);
-            int rest_value = 10 - heat_value;
-            gpio_set_level(HEATER_GPIO, 1);
-            gpio_set_level(BLUE_LED, 1);
-            ESP_LOGI(TAG, "heater> Up on");
-            vTaskDelay(heat_value * 1000 / portTICK_PERIOD_MS);
-            gpio_set_level(HEATER_GPIO, 0);
-            gpio_set_level(BLUE_LED, 0);
-            ESP_LOGI(TAG, "heater> Down off");
-            vTaskDelay(rest_value * 1000 / portTICK_PERIOD_MS);
-
-            heat_timer--;
-        }
-        else
-        {
-            gpio_set_level(HEATER_GPIO, 0);
-            gpio_set_level(BLUE_LED, 0);
-            ESP_LOGI(TAG, "heater> IDLE Down off");
-            static int idle_loop_i = 0;
-            if((idle_loop_i++ % 20) ==0)
-            {
-                publish_heat_status(0,0);
-            }
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
-        }
-        
-    }
+    gpio_set_level(HEATER_GPIO, 0);
+    gpio_set_level(BLUE_LED, 0);
+
+    heater_init(&heater);
+    heater_mutex = xSemaphoreCreateMutex();
+    esp_timer_create_args_t timer_args = {
+        .callback = &heater_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "heater"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &heater_timer));
+}
+
+void control_init()
+{
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(ntc_channel, ADC_ATTEN_DB_11);
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, DEFAULT_VREF, &adc_chars);
+    adc_cal_lut_init(&adc_lut, &adc_chars);
+    ntc_init(&ntc, 10000, 10000, 3950, 3300);
+    temp_control_init(&control, &default_gains);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = &control_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "control"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &control_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(control_timer, HEATER_PERIOD_MS * 1000));
 }
 
 
 void app_main()
 {
     ESP_LOGI(TAG, "[APP] Startup..");
+    log_ring_init();
     ESP_LOGI(TAG, "[APP] Free memory: %d bytes", esp_get_free_heap_size());
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
 
@@ -236,9 +358,11 @@ void app_main()
     esp_log_level_set("OUTBOX", ESP_LOG_VERBOSE);
 
     nvs_flash_init();
-    wifi_init();
-
-    xTaskCreate(&heater_gpio_task, "heater_gpio_task", 2048, NULL, 5, NULL);
-
-    mqtt_app_start();
+    //before the router, a command can come as soon as the client connects
+    heater_init_outputs();
+    control_init();
+    xTaskCreate(&heater_status_task, "heater_status_task", 2048, NULL, 5, &heater_status_task_handle);
+    mqtt_routes_init();
+    iot_wifi_init();
+    iot_mqtt_start(TOPIC_STATUS, TOPIC_SUB, &router);
 }
@@ -0,0 +1,112 @@
+/*
+ * heater.c
+ *
+ * see heater.h
+ */
+
+#include <string.h>
+
+#include "heater.h"
+
+static void set_output(heater_t *heater, bool on, int64_t now_ms)
+{
+    if(on == heater->on)
+    {
+        return;
+    }
+    if(on)
+    {
+        heater->on_since_ms = now_ms;
+    }
+    else
+    {
+        heater->on_total_ms += now_ms - heater->on_since_ms;
+    }
+    heater->on = on;
+}
+
+void heater_init(heater_t *heater)
+{
+    memset(heater, 0, sizeof(heater_t));
+}
+
+void heater_request(heater_t *heater, int level, uint32_t duration_s, int64_t now_ms)
+{
+    if(level < 0)
+    {
+        level = 0;
+    }
+    if(level > HEATER_MAX_LEVEL)
+    {
+        level = HEATER_MAX_LEVEL;
+    }
+    heater->period_on_ms = level * 1000;
+    heater->period_start_ms = now_ms;
+    heater->end_ms = now_ms + (int64_t)duration_s * 1000;
+}
+
+void heater_set_duty(heater_t *heater, int permille, uint32_t duration_s, int64_t now_ms)
+{
+    if(permille < 0)
+    {
+        permille = 0;
+    }
+    if(permille > 1000)
+    {
+        permille = 1000;
+    }
+    //an idle heater starts its period now, a running one keeps it
+    if((heater->period_on_ms == 0) || (now_ms >= heater->end_ms))
+    {
+        heater->period_start_ms = now_ms;
+    }
+    heater->period_on_ms = permille * (HEATER_PERIOD_MS / 1000);
+    heater->end_ms = now_ms + (int64_t)duration_s * 1000;
+}
+
+int64_t heater_update(heater_t *heater, int64_t now_ms)
+{
+    if((heater->period_on_ms == 0) || (now_ms >= heater->end_ms))
+    {
+        set_output(heater, false, now_ms);
+        return HEATER_NO_DEADLINE;
+    }
+    int64_t elapsed = now_ms - heater->period_start_ms;
+    int64_t period_start = now_ms - (elapsed % HEATER_PERIOD_MS);
+    int64_t off_ms = period_start + heater->period_on_ms;
+    int64_t deadline;
+    if(now_ms < off_ms)
+    {
+        set_output(heater, true, now_ms);
+        deadline = off_ms;
+    }
+    else
+    {
+        set_output(heater, false, now_ms);
+        deadline = period_start + HEATER_PERIOD_MS;
+    }
+    return (deadline < heater->end_ms) ? deadline : heater->end_ms;
+}
+
+int heater_level(const heater_t *heater, int64_t now_ms)
+{
+    return (now_ms < heater->end_ms) ? (heater->period_on_ms + 500) / 1000 : 0;
+}
+
+uint32_t heater_periods_left(const heater_t *heater, int64_t now_ms)
+{
+    if((heater->period_on_ms == 0) || (now_ms >= heater->end_ms))
+    {
+        return 0;
+    }
+    return (heater->end_ms - now_ms + HEATER_PERIOD_MS - 1) / HEATER_PERIOD_MS;
+}
+
+int64_t heater_on_ms(const heater_t *heater, int64_t now_ms)
+{
+    if(heater->on)
+    {
+        return heater->on_total_ms + (now_ms - heater->on_since_ms);
+    }
+    return heater->on_total_ms;
+}
@@ -0,0 +1,91 @@
+/*
+ * heater.h
+ *
+ * Slow PWM of the heater relay as a state machine of the time, without
+ * FreeRTOS, timers nor GPIO : the caller gives the current time, applies the
+ * output and calls heater_update() again at the returned deadline. The
+ * firmware drives it with an esp_timer, a host simulation with its own clock.
+ *
+ * A request restarts the period at once, the new level does not wait for
+ * the end of the running period. A duty from the temperature control keeps
+ * the running period and moves its off edge. The on time is accounted to the
+ * millisecond over all the requests.
+ *
+ * @code{.c}
+ * heater_request(&heater, 4, 3600, now_ms);    //4 s on of each 10 s period for 1 h
+ * int64_t deadline = heater_update(&heater, now_ms);
+ * gpio_set_level(HEATER_GPIO, heater.on);
+ * ...
+ * //at the deadline
+ * deadline = heater_update(&heater, now_ms);
+ * gpio_set_level(HEATER_GPIO, heater.on);
+ * @endcode
+ */
+
+#ifndef MAIN_HEATER_H_
+#define MAIN_HEATER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEATER_PERIOD_MS    10000
+#define HEATER_MAX_LEVEL    10      //on seconds per period
+
+//returned by heater_update() when no change is scheduled
+#define HEATER_NO_DEADLINE  INT64_MAX
+
+typedef struct {
+    int32_t     period_on_ms;
+    int64_t     period_start_ms;
+    int64_t     end_ms;
+    bool        on;
+    int64_t     on_since_ms;
+    int64_t     on_total_ms;    //closed on periods only, see heater_on_ms()
+} heater_t;
+
+void heater_init(heater_t *heater);
+
+/**
+ * @param [in] level on seconds per period, clamped to 0..HEATER_MAX_LEVEL, 0 stops
+ * @param [in] duration_s from now, the previous request is replaced
+ */
+void heater_request(heater_t *heater, int level, uint32_t duration_s, int64_t now_ms);
+
+/**
+ * @brief the closed loop output, applied to the running period
+ * @param [in] permille 0 to 1000 of the period
+ * @param [in] duration_s from now, the caller renews it at each sample so that
+ * the heater stops if the control does
+ */
+void heater_set_duty(heater_t *heater, int permille, uint32_t duration_s, int64_t now_ms);
+
+/**
+ * @brief sets heater->on for the time
+ * @return the time of the next change, HEATER_NO_DEADLINE when idle
+ */
+int64_t heater_update(heater_t *heater, int64_t now_ms);
+
+/**
+ * @return the level running now, rounded to the on seconds for a duty, 0 when idle
+ */
+int heater_level(const heater_t *heater, int64_t now_ms);
+
+/**
+ * @return the periods left in the request, the "timer" of the telemetry
+ */
+uint32_t heater_periods_left(const heater_t *heater, int64_t now_ms);
+
+/**
+ * @return the cumulated on time, up to now
+ */
+int64_t heater_on_ms(const heater_t *heater, int64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_HEATER_H_ */
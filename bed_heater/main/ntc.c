@@ -0,0 +1,44 @@
+/*
+ * ntc.c
+ *
+ * see ntc.h
+ */
+
+#include <math.h>
+
+#include "ntc.h"
+
+void ntc_init(ntc_t *ntc, uint32_t r_pullup, uint32_t r25, uint32_t beta, uint32_t supply_mv)
+{
+    ntc->supply_mv = supply_mv;
+    for(int i=0;i<NTC_TABLE_SIZE;i++)
+    {
+        uint32_t mv = i * NTC_STEP_MV;
+        //one step from each end is kept out, a real sensor is not there
+        if((mv < NTC_STEP_MV) || (mv + NTC_STEP_MV > supply_mv))
+        {
+            ntc->c100[i] = NTC_INVALID;
+            continue;
+        }
+        float r = (float)r_pullup * mv / (supply_mv - mv);
+        float inv_t = 1.0f / 298.15f + logf(r / r25) / beta;
+        ntc->c100[i] = (int32_t)lroundf((1.0f / inv_t - 273.15f) * 100.0f);
+    }
+}
+
+int32_t ntc_mv_to_c100(const ntc_t *ntc, uint32_t mv)
+{
+    uint32_t index = mv / NTC_STEP_MV;
+    if(index + 1 >= NTC_TABLE_SIZE)
+    {
+        return NTC_INVALID;
+    }
+    int32_t low = ntc->c100[index];
+    int32_t high = ntc->c100[index + 1];
+    if((low == NTC_INVALID) || (high == NTC_INVALID))
+    {
+        return NTC_INVALID;
+    }
+    int32_t frac = mv - index * NTC_STEP_MV;
+    return low + ((high - low) * frac) / NTC_STEP_MV;
+}
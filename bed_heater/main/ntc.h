@@ -0,0 +1,53 @@
+/*
+ * ntc.h
+ *
+ * Temperature of an NTC thermistor in a divider, the pull-up resistor to the
+ * supply and the NTC to the ground, from the voltage of the middle point.
+ *
+ * The beta equation needs a logarithm, it is evaluated once per 100 mV by
+ * ntc_init() and a measure is then interpolated between two entries with
+ * integers only. The voltages close to the ground and to the supply are
+ * reported as NTC_INVALID : a shorted or a disconnected sensor.
+ *
+ * @code{.c}
+ * ntc_init(&ntc, 10000, 10000, 3950, 3300);    //10k pull-up, 10k B3950 NTC, 3.3 V
+ * int32_t temp = ntc_mv_to_c100(&ntc, mv);     //centi-degrees
+ * @endcode
+ */
+
+#ifndef MAIN_NTC_H_
+#define MAIN_NTC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NTC_STEP_MV     100
+#define NTC_MAX_MV      3300
+#define NTC_TABLE_SIZE  (NTC_MAX_MV / NTC_STEP_MV + 1)
+
+#define NTC_INVALID     INT32_MIN
+
+typedef struct {
+    int32_t     c100[NTC_TABLE_SIZE];   //centi-degrees at each step, NTC_INVALID at the ends
+    uint32_t    supply_mv;
+} ntc_t;
+
+/**
+ * @param [in] r_pullup r25 in ohms, r25 the NTC resistance at 25 degrees
+ * @param [in] supply_mv the top of the divider, at most NTC_MAX_MV
+ */
+void ntc_init(ntc_t *ntc, uint32_t r_pullup, uint32_t r25, uint32_t beta, uint32_t supply_mv);
+
+/**
+ * @return the temperature in centi-degrees, NTC_INVALID for a shorted or open sensor
+ */
+int32_t ntc_mv_to_c100(const ntc_t *ntc, uint32_t mv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_NTC_H_ */
@@ -0,0 +1,178 @@
+/*
+ * temp_control.c
+ *
+ * see temp_control.h
+ */
+
+#include <string.h>
+
+#include "temp_control.h"
+
+#define Q16         16
+#define MAX_Q16     ((int64_t)TEMP_CONTROL_MAX_DUTY << Q16)
+
+//relay output amplitude, half of the 0 to full swing
+#define RELAY_D     (TEMP_CONTROL_MAX_DUTY / 2)
+
+void temp_control_init(temp_control_t *control, const temp_gains_t *gains)
+{
+    memset(control, 0, sizeof(temp_control_t));
+    control->gains = *gains;
+}
+
+void temp_control_set_target(temp_control_t *control, int32_t target)
+{
+    if(target <= 0)
+    {
+        temp_control_off(control);
+        return;
+    }
+    control->mode = TEMP_CONTROL_PID;
+    control->target = target;
+    control->integral = 0;
+    control->has_last = false;
+}
+
+void temp_control_autotune(temp_control_t *control, int32_t target)
+{
+    temp_control_set_target(control, target);
+    if(control->mode == TEMP_CONTROL_OFF)
+    {
+        return;
+    }
+    control->mode = TEMP_CONTROL_AUTOTUNE;
+    control->relay_on = false;
+    control->switches = 0;
+    control->samples = 0;
+    control->period_sum = 0;
+    control->amplitude_sum = 0;
+    control->cycles = 0;
+}
+
+void temp_control_off(temp_control_t *control)
+{
+    control->mode = TEMP_CONTROL_OFF;
+    control->target = 0;
+    control->duty = 0;
+}
+
+static int pid_step(temp_control_t *control, int32_t temp)
+{
+    int32_t error = control->target - temp;
+    int64_t p = (int64_t)control->gains.kp * error;
+    int64_t d = 0;
+    if(control->has_last)
+    {
+        d = -(int64_t)control->gains.kd * (temp - control->last_temp);
+    }
+    control->last_temp = temp;
+    control->has_last = true;
+
+    int64_t integral = control->integral + (int64_t)control->gains.ki * error;
+    int64_t output = p + integral + d;
+    bool saturated = ((output > MAX_Q16) && (error > 0)) || ((output < 0) && (error < 0));
+    if(!saturated)
+    {
+        control->integral = integral;
+    }
+    if(control->integral > MAX_Q16)
+    {
+        control->integral = MAX_Q16;
+    }
+    else if(control->integral < 0)
+    {
+        control->integral = 0;
+    }
+
+    output = p + control->integral + d;
+    if(output <= 0)
+    {
+        return 0;
+    }
+    if(output >= MAX_Q16)
+    {
+        return TEMP_CONTROL_MAX_DUTY;
+    }
+    return (int)((output + (1 << (Q16 - 1))) >> Q16);
+}
+
+//Ziegler-Nichols from the measured cycles, Ku = 4 d / (pi a) with pi ~ 355/113
+static void autotune_gains(temp_control_t *control)
+{
+    int64_t amplitude = control->amplitude_sum / (2 * control->cycles);
+    int64_t tu = control->period_sum / control->cycles;
+    if(amplitude < 1)
+    {
+        amplitude = 1;
+    }
+    if(tu < 1)
+    {
+        tu = 1;
+    }
+    int64_t ku = ((int64_t)4 * RELAY_D * 113 << Q16) / (355 * amplitude);
+    int64_t kp = ku * 6 / 10;
+    control->gains.kp = (int32_t)kp;
+    control->gains.ki = (int32_t)(kp * 2 / tu);
+    control->gains.kd = (int32_t)(kp * tu / 8);
+}
+
+static int autotune_step(temp_control_t *control, int32_t temp)
+{
+    control->samples++;
+    if(temp > control->peak_max)
+    {
+        control->peak_max = temp;
+    }
+    if(temp < control->peak_min)
+    {
+        control->peak_min = temp;
+    }
+    if(control->relay_on && (temp > control->target + TEMP_AUTOTUNE_HYSTERESIS))
+    {
+        control->relay_on = false;
+    }
+    else if(!control->relay_on && (temp < control->target - TEMP_AUTOTUNE_HYSTERESIS))
+    {
+        control->relay_on = true;
+        //a cycle goes from a switch on to the next, the heat up before the first one is not a cycle
+        if(control->switches >= 2)
+        {
+            control->period_sum += control->samples - control->cycle_start;
+            control->amplitude_sum += control->peak_max - control->peak_min;
+            control->cycles++;
+        }
+        control->switches++;
+        control->cycle_start = control->samples;
+        control->peak_max = temp;
+        control->peak_min = temp;
+        if(control->cycles == TEMP_AUTOTUNE_CYCLES)
+        {
+            autotune_gains(control);
+            temp_control_set_target(control, control->target);
+            return pid_step(control, temp);
+        }
+    }
+    return control->relay_on ? TEMP_CONTROL_MAX_DUTY : 0;
+}
+
+int temp_control_step(temp_control_t *control, int32_t temp)
+{
+    if((temp == INT32_MIN) || (temp > TEMP_CONTROL_MAX_C100))
+    {
+        control->duty = 0;
+        return 0;
+    }
+    switch(control->mode)
+    {
+        case TEMP_CONTROL_PID:
+            control->duty = pid_step(control, temp);
+            break;
+        case TEMP_CONTROL_AUTOTUNE:
+            control->duty = autotune_step(control, temp);
+            break;
+        default:
+            control->duty = 0;
+            break;
+    }
+    return control->duty;
+}
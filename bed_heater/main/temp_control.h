@@ -0,0 +1,115 @@
+/*
+ * temp_control.h
+ *
+ * Closed loop heater duty from the measured temperature, with integers only.
+ *
+ * The PID is stepped once per sample with the temperature in centi-degrees
+ * and returns the duty in permille. The gains are Q16 fixed point, in
+ * permille per centi-degree, the integral and derivative ones per sample. The
+ * derivative is taken on the measure so that a new target does not kick the
+ * output. The integral stops growing while the output is saturated in the
+ * direction of the error (conditional integration) and stays within the
+ * output range, so a long heat up does not overshoot from a wound up
+ * integral.
+ *
+ * The autotune is the relay method of Astrom and Hagglund : the output
+ * switches between 0 and full around the target, the amplitude a and the
+ * period Tu of the resulting oscillation give the ultimate gain
+ * Ku = 4 d / (pi a), and the Ziegler-Nichols rules give
+ * Kp = 0.6 Ku, Ti = Tu / 2, Td = Tu / 8. The control goes on with the new
+ * gains on the same target.
+ *
+ * @code{.c}
+ * temp_control_init(&control, &default_gains);
+ * temp_control_set_target(&control, 4500);     //45.00 degrees
+ * ...
+ * //every sample
+ * int duty = temp_control_step(&control, ntc_mv_to_c100(&ntc, mv));
+ * @endcode
+ */
+
+#ifndef MAIN_TEMP_CONTROL_H_
+#define MAIN_TEMP_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEMP_CONTROL_MAX_DUTY       1000
+
+//the output is cut over this or on a sensor fault, whatever the mode
+#ifndef TEMP_CONTROL_MAX_C100
+#define TEMP_CONTROL_MAX_C100       9000
+#endif
+
+//relay hysteresis around the target
+#ifndef TEMP_AUTOTUNE_HYSTERESIS
+#define TEMP_AUTOTUNE_HYSTERESIS    50
+#endif
+
+//oscillations measured after the first one
+#ifndef TEMP_AUTOTUNE_CYCLES
+#define TEMP_AUTOTUNE_CYCLES        3
+#endif
+
+typedef enum {
+    TEMP_CONTROL_OFF,
+    TEMP_CONTROL_PID,
+    TEMP_CONTROL_AUTOTUNE
+} temp_control_mode_t;
+
+typedef struct {
+    int32_t     kp;
+    int32_t     ki;
+    int32_t     kd;
+} temp_gains_t;
+
+typedef struct {
+    temp_control_mode_t mode;
+    int32_t         target;         //centi-degrees
+    temp_gains_t    gains;
+    int64_t         integral;       //permille Q16
+    int32_t         last_temp;
+    bool            has_last;
+    int             duty;
+    //autotune
+    bool            relay_on;
+    int             switches;       //relay switched on, the first cycle is not measured
+    uint32_t        samples;
+    uint32_t        cycle_start;
+    int32_t         peak_max;
+    int32_t         peak_min;
+    uint32_t        period_sum;     //samples
+    int32_t         amplitude_sum;  //peak to peak, centi-degrees
+    int             cycles;
+} temp_control_t;
+
+void temp_control_init(temp_control_t *control, const temp_gains_t *gains);
+
+/**
+ * @brief PID on the target, the integral restarts from 0
+ * @param [in] target centi-degrees, 0 or less stops the control
+ */
+void temp_control_set_target(temp_control_t *control, int32_t target);
+
+/**
+ * @brief relay oscillation around the target, then PID with the new gains
+ */
+void temp_control_autotune(temp_control_t *control, int32_t target);
+
+void temp_control_off(temp_control_t *control);
+
+/**
+ * @param [in] temp centi-degrees, INT32_MIN for a sensor fault
+ * @return the duty in permille, 0 when off
+ */
+int temp_control_step(temp_control_t *control, int32_t temp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_TEMP_CONTROL_H_ */
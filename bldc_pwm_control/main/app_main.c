@@ -19,18 +19,22 @@
 
 #include "esp_log.h"
 #include "mqtt_client.h"
+#include "iot_core.h"
+#include "boot_timeline.h"
+#include "log_ring.h"
+#include "telemetry.h"
 
 #include "driver/mcpwm.h"
 #include "soc/mcpwm_reg.h"
 #include "soc/mcpwm_struct.h"
 
 static const char *TAG = "MQTT_EXAMPLE";
-
-static EventGroupHandle_t wifi_event_group;
-const static int CONNECTED_BIT = BIT0;
-
-esp_mqtt_client_handle_t g_client;
-bool is_client_ready = false;
+static const char* TOPIC_PWM    = "esp/motor/pwm";
+static const char* TOPIC_STATUS = "esp/motor/status";
+static const char* TOPIC_TELEMETRY = "esp/motor/telemetry";
+//the angle was published on the status topic by the previous versions, kept
+//next to the telemetry until its subscribers read the document, 0 to drop it
+#define LEGACY_TOPICS 1
 
 #define BLUE_LED 2
 #define PWM_GPIO 13
@@ -75,139 +79,45 @@ int atoi_n(const char * str,int len)
     return atoi(str_end_0);
 }
 
+//the position goes with its pulse width, the status topic is left to the LWT once
+//the legacy topics are dropped
 void mqtt_publish_motor_status(int val)
 {
-    if(is_client_ready)
+    telemetry_t doc;
+    if(telemetry_begin(&doc))
     {
-        char payload[10];
-        sprintf(payload,"%d",val);
-        int msg_id = esp_mqtt_client_publish(g_client, "esp/motor/status", payload, 0, 1, 0);
+        telemetry_add_int(&doc, "angle", val);
+        telemetry_add_uint(&doc, "pulse_us", servo_per_degree_init(val));
+        int msg_id = telemetry_publish(&doc, TOPIC_TELEMETRY, 1, 0);
         ESP_LOGD(TAG, "motor> sent publish successful, msg_id=%d", msg_id);
     }
-    else
-    {
-        ESP_LOGW(TAG, "mqtt client not ready");
-    }
+#if LEGACY_TOPICS
+    iot_publishf(TOPIC_STATUS, 1, 0, "%d", val);
+#endif
 }
 
 void motor_set_degrees(uint32_t angle_deg)
 {
     uint32_t angle_us = servo_per_degree_init(angle_deg);
-    printf("motor> pulse width: %dus\n", angle_us);
+    LOG_RING_I(TAG, "motor> pulse width: %dus", angle_us);
     mcpwm_set_duty_in_us(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_A, angle_us);
 }
 
-void motor_handle_payload(const char * payload,int len)
+void motor_handle_payload(char * payload,int len)
 {
     uint32_t val = atoi_n(payload,len);
     motor_set_degrees(val);
     mqtt_publish_motor_status(val);
 }
 
+topic_router_t router;
 
-
-static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
-{
-    g_client = event->client;//update g_client
-    int msg_id;
-    // your_context_t *context = event->context;
-    switch (event->event_id) {
-        case MQTT_EVENT_CONNECTED:
-            is_client_ready = true;
-            ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
-            msg_id = esp_mqtt_client_publish(g_client, "esp/motor/status", "online", 0, 1, 1);
-            ESP_LOGI(TAG, "MQTT> sent publish successful, msg_id=%d", msg_id);
-
-            msg_id = esp_mqtt_client_subscribe(g_client, "esp/motor/pwm", 0);
-            ESP_LOGI(TAG, "MQTT> sent subscribe successful, msg_id=%d", msg_id);
-
-            break;
-        case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-            is_client_ready = false;
-            break;
-
-        case MQTT_EVENT_SUBSCRIBED:
-            break;
-        case MQTT_EVENT_UNSUBSCRIBED:
-            ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-            printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("DATA=%.*s\r\n", event->data_len, event->data);
-            if(strncmp(event->topic,"esp/motor/pwm",event->topic_len) == 0)
-            {
-                motor_handle_payload(event->data,event->data_len);
-            }
-            else
-            {
-                ESP_LOGI(TAG, "MQTT> unhandled topic %s", event->topic);
-            }
-            break;
-        case MQTT_EVENT_ERROR:
-            ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
-            break;
-    }
-    return ESP_OK;
-}
-
-static esp_err_t wifi_event_handler(void *ctx, system_event_t *event)
-{
-    switch (event->event_id) {
-        case SYSTEM_EVENT_STA_START:
-            esp_wifi_connect();
-            break;
-        case SYSTEM_EVENT_STA_GOT_IP:
-            xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
-
-            break;
-        case SYSTEM_EVENT_STA_DISCONNECTED:
-            esp_wifi_connect();
-            xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
-            break;
-        default:
-            break;
-    }
-    return ESP_OK;
-}
-
-static void wifi_init(void)
+void mqtt_routes_init()
 {
-    tcpip_adapter_init();
-    wifi_event_group = xEventGroupCreate();
-    ESP_ERROR_CHECK(esp_event_loop_init(wifi_event_handler, NULL));
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = CONFIG_WIFI_SSID,
-            .password = CONFIG_WIFI_PASSWORD,
-        },
-    };
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
-    ESP_LOGI(TAG, "start the WIFI SSID:[%s]", CONFIG_WIFI_SSID);
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "Waiting for wifi");
-    xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, false, true, portMAX_DELAY);
+    topic_router_init(&router);
+    topic_router_add(&router, TOPIC_PWM, &motor_handle_payload);
 }
 
-static void mqtt_app_start(void)
-{
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .uri = CONFIG_BROKER_URL,
-        .event_handle = mqtt_event_handler,
-        // .user_context = (void *)your_context
-    };
-
-    g_client = esp_mqtt_client_init(&mqtt_cfg);
-    esp_mqtt_client_start(g_client);
-}
 
 void motor_init()
 {
@@ -224,13 +134,19 @@ void motor_init()
     pwm_config.duty_mode = MCPWM_DUTY_MODE_0;
     mcpwm_init(MCPWM_UNIT_0, MCPWM_TIMER_0, &pwm_config);    //Configure PWM0A & PWM0B with above settings
 }
+//self-test sweep, stopped by the first command so that it is served right away
 void motor_start()
 {
+    if(!iot_boot_begin())
+        return;
     motor_set_degrees(0);
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    if(!iot_boot_delay_ms(1000))
+        return;
     motor_set_degrees(90);
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    if(!iot_boot_delay_ms(1000))
+        return;
     motor_set_degrees(0);
+    iot_boot_end();
 }
 
 void alive_task(void *pvParameter)
@@ -251,8 +167,10 @@ void alive_task(void *pvParameter)
 void app_main()
 {
     motor_init();
+    boot_timeline_mark("motor ready");
 
     ESP_LOGI(TAG, "[APP] Startup..");
+    log_ring_init();
     ESP_LOGI(TAG, "[APP] Free memory: %d bytes", esp_get_free_heap_size());
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
 
@@ -269,10 +187,13 @@ void app_main()
 
 
     nvs_flash_init();
-    wifi_init();
+    mqtt_routes_init();
+    iot_wifi_init();
+    iot_mqtt_start(TOPIC_STATUS, TOPIC_PWM, &router);
 
     xTaskCreate(&alive_task, "alive_task", 4096, NULL, 5, NULL);
     
+    //runs while the station associates
     motor_start();
-    mqtt_app_start();
+    boot_timeline_mark("motor self-test");
 }
@@ -0,0 +1,32 @@
+/*
+ * adc_cal_lut.c
+ *
+ * see adc_cal_lut.h
+ */
+
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "adc_cal_lut.h"
+
+static const char *TAG = "adc_cal_lut";
+
+bool adc_cal_lut_init(adc_cal_lut_t *lut, const esp_adc_cal_characteristics_t *chars)
+{
+    //ADC_WIDTH_BIT_9 is 0, up to ADC_WIDTH_BIT_12 which is 3
+    lut->size = 1u << (9 + chars->bit_width);
+    lut->mv = (uint16_t *)malloc(lut->size * sizeof(uint16_t));
+    if(lut->mv == NULL)
+    {
+        ESP_LOGE(TAG, "no memory for %u entries", lut->size);
+        lut->size = 0;
+        return false;
+    }
+    for(uint32_t raw=0;raw<lut->size;raw++)
+    {
+        lut->mv[raw] = esp_adc_cal_raw_to_voltage(raw, chars);
+    }
+    ESP_LOGI(TAG, "%u entries, %u mV to %u mV", lut->size, lut->mv[0], lut->mv[lut->size - 1]);
+    return true;
+}
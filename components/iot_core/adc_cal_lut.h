@@ -0,0 +1,53 @@
+/*
+ * adc_cal_lut.h
+ *
+ * esp_adc_cal_raw_to_voltage() evaluated once for every raw code, so that a
+ * conversion in a sampling loop is a single table load.
+ *
+ * The table has one uint16_t per code of the characterized width, 8 KB for
+ * 12 bits, allocated by adc_cal_lut_init(). The entries are the reference
+ * conversion itself, there is no approximation.
+ *
+ * @code{.c}
+ * esp_adc_cal_characterize(unit, atten, ADC_WIDTH_BIT_12, DEFAULT_VREF, &adc_chars);
+ * adc_cal_lut_init(&adc_lut, &adc_chars);
+ * ...
+ * uint32_t mv = adc_cal_lut_to_mv(&adc_lut, adc1_get_raw(channel));
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_ADC_CAL_LUT_H_
+#define COMPONENTS_IOT_CORE_ADC_CAL_LUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_adc_cal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t   *mv;
+    uint32_t    size;
+} adc_cal_lut_t;
+
+/**
+ * @brief fills the table from the characteristics, the characteristics are not used afterwards
+ * @return false if the table could not be allocated
+ */
+bool adc_cal_lut_init(adc_cal_lut_t *lut, const esp_adc_cal_characteristics_t *chars);
+
+/**
+ * @param [in] raw code of the characterized width, saturated to the last entry
+ */
+static inline uint32_t adc_cal_lut_to_mv(const adc_cal_lut_t *lut, uint32_t raw)
+{
+    return lut->mv[(raw < lut->size) ? raw : (lut->size - 1)];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_ADC_CAL_LUT_H_ */
@@ -0,0 +1,151 @@
+/*
+ * battery_monitor.c
+ *
+ * see battery_monitor.h
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "battery_monitor.h"
+
+static const char *TAG = "battery";
+
+//bursts before the median window is full
+#define PRIMING_PERIOD_MS 100
+
+static battery_monitor_config_t g_config;
+static battery_filter_t g_filter;
+static volatile uint32_t g_mv = 0;
+static volatile TickType_t g_led_tick = 0;
+
+void battery_filter_init(battery_filter_t *filter)
+{
+    memset(filter, 0, sizeof(battery_filter_t));
+}
+
+uint16_t battery_burst_reduce(uint16_t *samples, int nb)
+{
+    //insertion sort, the bursts are short
+    for(int i=1;i<nb;i++)
+    {
+        uint16_t value = samples[i];
+        int j = i;
+        while((j > 0) && (samples[j-1] > value))
+        {
+            samples[j] = samples[j-1];
+            j--;
+        }
+        samples[j] = value;
+    }
+    int first = nb / 4;
+    int last = nb - nb / 4;
+    uint32_t sum = 0;
+    for(int i=first;i<last;i++)
+    {
+        sum += samples[i];
+    }
+    return (sum + (last - first) / 2) / (last - first);
+}
+
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if(a > b)
+    {
+        uint16_t t = a; a = b; b = t;
+    }
+    //a <= b
+    if(c <= a)
+    {
+        return a;
+    }
+    return (c < b) ? c : b;
+}
+
+uint16_t battery_filter_push(battery_filter_t *filter, uint16_t burst)
+{
+    filter->history[filter->nb % 3] = burst;
+    filter->nb++;
+    uint16_t median = burst;
+    if(filter->nb >= 3)
+    {
+        median = median3(filter->history[0], filter->history[1], filter->history[2]);
+    }
+    if(filter->nb <= 3)
+    {
+        //the IIR starts from the median rather than ramping from 0
+        filter->iir = (int32_t)median << 4;
+    }
+    else
+    {
+        filter->iir += (((int32_t)median << 4) - filter->iir) >> BATTERY_IIR_SHIFT;
+        if(filter->nb == 6)
+        {
+            filter->nb = 3;     //keeps the counter bounded, same history slot order
+        }
+    }
+    return (filter->iir + 8) >> 4;
+}
+
+static void battery_task(void *pvParameters)
+{
+    uint16_t samples[BATTERY_BURST_SAMPLES];
+    uint32_t published_mv = 0;
+    TickType_t published_tick = 0;
+    bool published = false;
+
+    while(1)
+    {
+        bool primed = (g_filter.nb >= 3);
+        vTaskDelay((primed ? g_config.period_ms : PRIMING_PERIOD_MS) / portTICK_PERIOD_MS);
+        while((TickType_t)(xTaskGetTickCount() - g_led_tick) < (BATTERY_LED_SETTLE_MS / portTICK_PERIOD_MS))
+        {
+            vTaskDelay(BATTERY_LED_SETTLE_MS / portTICK_PERIOD_MS);
+        }
+        for(int i=0;i<BATTERY_BURST_SAMPLES;i++)
+        {
+            samples[i] = g_config.read_raw();
+        }
+        uint16_t burst = battery_burst_reduce(samples, BATTERY_BURST_SAMPLES);
+        uint16_t filtered = battery_filter_push(&g_filter, burst);
+        uint32_t mv = g_config.raw_to_mv(filtered);
+        g_mv = mv;
+        if(g_filter.nb < 3)
+        {
+            continue;
+        }
+
+        TickType_t now = xTaskGetTickCount();
+        uint32_t delta = (mv > published_mv) ? (mv - published_mv) : (published_mv - mv);
+        bool heartbeat = (g_config.heartbeat_s != 0) &&
+                         ((now - published_tick) * portTICK_PERIOD_MS >= g_config.heartbeat_s * 1000);
+        if(!published || (delta >= g_config.threshold_mv) || heartbeat)
+        {
+            ESP_LOGI(TAG, "%u mV (burst raw %u filtered %u)", mv, burst, filtered);
+            g_config.on_change(mv);
+            published_mv = mv;
+            published_tick = now;
+            published = true;
+        }
+    }
+}
+
+void battery_monitor_init(const battery_monitor_config_t *config)
+{
+    g_config = *config;
+    battery_filter_init(&g_filter);
+    xTaskCreate(&battery_task, "battery", 3072, NULL, 4, NULL);
+}
+
+void battery_monitor_led_activity(void)
+{
+    g_led_tick = xTaskGetTickCount();
+}
+
+uint32_t battery_monitor_get_mv(void)
+{
+    return g_mv;
+}
@@ -0,0 +1,107 @@
+/*
+ * battery_monitor.h
+ *
+ * Battery voltage from bursts of ADC samples instead of a single raw read.
+ *
+ * Every period a burst of samples is taken back to back, once the leds have
+ * been quiet for a while (the WS2812 current steps show on the battery). The
+ * burst is sorted and the middle half averaged, the median of the last three
+ * bursts rejects a burst disturbed anyway, and a first order IIR smooths the
+ * result. The filter works on the raw codes, only the filtered code is
+ * converted to millivolts.
+ *
+ * The value is given to the callback only when it moved by the threshold
+ * since the last one, or when the heartbeat is due, so a stable battery
+ * costs one message per heartbeat.
+ *
+ * The filter functions do not depend on the ADC nor on FreeRTOS and can be
+ * fed with recorded traces.
+ *
+ * @code{.c}
+ * battery_monitor_config_t config = {
+ *     .read_raw = &adc_read_raw,
+ *     .raw_to_mv = &adc_raw_to_mv,
+ *     .on_change = &publish_battery_voltage,
+ *     .period_ms = 10000,
+ *     .threshold_mv = 20,
+ *     .heartbeat_s = 3600
+ * };
+ * battery_monitor_init(&config);
+ * ...
+ * my_rgb.show();
+ * battery_monitor_led_activity();
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_BATTERY_MONITOR_H_
+#define COMPONENTS_IOT_CORE_BATTERY_MONITOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//samples per burst
+#ifndef BATTERY_BURST_SAMPLES
+#define BATTERY_BURST_SAMPLES 16
+#endif
+
+//IIR weight of a new burst, 1 / 2^shift
+#ifndef BATTERY_IIR_SHIFT
+#define BATTERY_IIR_SHIFT 2
+#endif
+
+//no burst until the leds have not changed for this long
+#ifndef BATTERY_LED_SETTLE_MS
+#define BATTERY_LED_SETTLE_MS 50
+#endif
+
+typedef struct {
+    uint16_t    history[3];     //last bursts for the median
+    int         nb;
+    int32_t     iir;            //raw code << 4
+} battery_filter_t;
+
+typedef struct {
+    uint16_t    (*read_raw)(void);
+    uint32_t    (*raw_to_mv)(uint16_t raw);
+    void        (*on_change)(uint32_t mv);
+    uint32_t    period_ms;
+    uint32_t    threshold_mv;
+    uint32_t    heartbeat_s;    //0 for changes only
+} battery_monitor_config_t;
+
+void battery_filter_init(battery_filter_t *filter);
+
+/**
+ * @brief sorts the samples in place and returns the mean of the middle half
+ */
+uint16_t battery_burst_reduce(uint16_t *samples, int nb);
+
+/**
+ * @brief adds a burst value and returns the filtered raw code
+ */
+uint16_t battery_filter_push(battery_filter_t *filter, uint16_t burst);
+
+/**
+ * @brief starts the sampling task, the config is copied
+ */
+void battery_monitor_init(const battery_monitor_config_t *config);
+
+/**
+ * @brief to call after each led update, delays the next burst by BATTERY_LED_SETTLE_MS
+ */
+void battery_monitor_led_activity(void);
+
+/**
+ * @return the last filtered voltage, 0 before the first burst
+ */
+uint32_t battery_monitor_get_mv(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_BATTERY_MONITOR_H_ */
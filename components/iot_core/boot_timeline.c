@@ -0,0 +1,49 @@
+/*
+ * boot_timeline.c
+ *
+ * see boot_timeline.h
+ */
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "boot_timeline.h"
+
+static const char *TAG = "boot";
+
+typedef struct {
+    const char *stage;
+    int64_t     time_us;
+} boot_mark_t;
+
+static boot_mark_t g_marks[BOOT_TIMELINE_MAX_MARKS];
+static int g_nb_marks = 0;
+static portMUX_TYPE g_marks_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_timeline_mark(const char *stage)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&g_marks_mux);
+    if(g_nb_marks < BOOT_TIMELINE_MAX_MARKS)
+    {
+        g_marks[g_nb_marks].stage = stage;
+        g_marks[g_nb_marks].time_us = now;
+        g_nb_marks++;
+    }
+    portEXIT_CRITICAL(&g_marks_mux);
+    ESP_LOGI(TAG, "boot> %s at %lld ms", stage, now/1000);
+}
+
+void boot_timeline_log(void)
+{
+    int64_t previous = 0;
+    for(int i=0;i<g_nb_marks;i++)
+    {
+        ESP_LOGI(TAG, "boot> %6lld ms (+%5lld ms) %s", g_marks[i].time_us/1000,
+                        (g_marks[i].time_us - previous)/1000, g_marks[i].stage);
+        previous = g_marks[i].time_us;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * boot_timeline.h
+ *
+ * Timestamps of the startup stages, measured with esp_timer from the boot.
+ * Each mark is logged when it happens, and the whole timeline can be logged
+ * at once to compare the time to ready between firmware versions.
+ *
+ * @code{.c}
+ * boot_timeline_mark("leds ready");
+ * ...
+ * boot_timeline_log();
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_BOOT_TIMELINE_H_
+#define COMPONENTS_IOT_CORE_BOOT_TIMELINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BOOT_TIMELINE_MAX_MARKS
+#define BOOT_TIMELINE_MAX_MARKS 16
+#endif
+
+/**
+ * @brief record the current time for a startup stage, marks past the max are dropped
+ * @param [in] stage the stage name, not copied
+ */
+void boot_timeline_mark(const char *stage);
+
+void boot_timeline_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_BOOT_TIMELINE_H_ */
@@ -0,0 +1,6 @@
+#
+# iot_core component makefile.
+#
+# shared network path of the firmware apps
+
+COMPONENT_ADD_INCLUDEDIRS := .
@@ -0,0 +1,271 @@
+/*
+ * gpio_events.c
+ *
+ * see gpio_events.h
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+
+#include "gpio_events.h"
+
+static const char *TAG = "gpio_events";
+
+#if (GPIO_EVENTS_RING_SIZE & (GPIO_EVENTS_RING_SIZE - 1)) != 0
+#error "GPIO_EVENTS_RING_SIZE must be a power of 2"
+#endif
+
+typedef struct {
+    gpio_event_t    event;
+    uint8_t         slot;
+} event_record_t;
+
+typedef struct {
+    gpio_num_t              pin;
+    gpio_int_type_t         type;
+    uint32_t                debounce_us;
+    gpio_event_handler_t    handler;
+    void                   *arg;
+    //written by the ISR
+    int64_t                 last_us;
+    volatile uint32_t       events;
+    volatile uint32_t       bounces;
+    volatile uint32_t       dropped;
+    //written by the task
+    int64_t                 window_us;
+    uint32_t                window_count;
+    volatile uint32_t       rate;
+    uint8_t                 reported_level; //level of the last event given to the handler
+    bool                    settle_pending;
+    int64_t                 settle_us;      //end of the debounce window of that event
+    volatile uint32_t       settled;
+} pin_slot_t;
+
+static event_record_t g_ring[GPIO_EVENTS_RING_SIZE];
+static volatile uint32_t g_head = 0;    //next record to write, only by the ISR
+static volatile uint32_t g_tail = 0;    //next record to drain, only by the task
+static pin_slot_t g_slots[GPIO_EVENTS_MAX_PINS];
+static volatile int g_nb_slots = 0;
+static TaskHandle_t g_events_task = NULL;
+
+//the ISR service calls the handlers of all the pins from the same interrupt,
+//so there is a single producer and no lock is needed
+static void IRAM_ATTR gpio_events_isr(void *arg)
+{
+    pin_slot_t *slot = (pin_slot_t *)arg;
+    int64_t now = esp_timer_get_time();
+    uint32_t in = (slot->pin < 32) ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+    uint8_t level = (in >> (slot->pin & 31)) & 1;
+
+    if((now - slot->last_us) < slot->debounce_us)
+    {
+        slot->bounces++;
+        return;
+    }
+    slot->last_us = now;
+    uint32_t head = g_head;
+    if((head - g_tail) == GPIO_EVENTS_RING_SIZE)
+    {
+        slot->dropped++;
+        return;
+    }
+    event_record_t *record = &g_ring[head & (GPIO_EVENTS_RING_SIZE - 1)];
+    record->event.time_us = now;
+    record->event.pin = slot->pin;
+    record->event.level = level;
+    record->slot = slot - g_slots;
+    //the record has to be complete before the task can see it
+    __sync_synchronize();
+    g_head = head + 1;
+    slot->events++;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(g_events_task, &woken);
+    if(woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void update_rates(int64_t now)
+{
+    for(int i=0;i<g_nb_slots;i++)
+    {
+        pin_slot_t *slot = &g_slots[i];
+        int64_t elapsed = now - slot->window_us;
+        if(elapsed >= 1000000)
+        {
+            slot->rate = (uint32_t)(((uint64_t)slot->window_count * 1000000) / elapsed);
+            slot->window_count = 0;
+            slot->window_us = now;
+        }
+    }
+}
+
+static void deliver(pin_slot_t *slot, const gpio_event_t *event)
+{
+    slot->window_count++;
+    slot->reported_level = event->level;
+    if(slot->handler)
+    {
+        slot->handler(event, slot->arg);
+    }
+}
+
+//the ISR drops every edge of the debounce window, the last one of a bounce
+//included, so with both edges captured the pin is read again at the end of
+//the window and its level is given to the handler if it is not the reported one
+//returns the ticks until the next window ends
+static TickType_t settle_pins(int64_t now)
+{
+    int64_t next_us = now + 1000000;
+    for(int i=0;i<g_nb_slots;i++)
+    {
+        pin_slot_t *slot = &g_slots[i];
+        if(!slot->settle_pending)
+        {
+            continue;
+        }
+        if(now < slot->settle_us)
+        {
+            if(slot->settle_us < next_us)
+            {
+                next_us = slot->settle_us;
+            }
+            continue;
+        }
+        //an edge accepted meanwhile is still in the ring and opens a new window
+        if(g_tail != g_head)
+        {
+            return 0;
+        }
+        slot->settle_pending = false;
+        uint8_t level = gpio_get_level(slot->pin);
+        if(level != slot->reported_level)
+        {
+            gpio_event_t event = {
+                .time_us = now,
+                .pin = slot->pin,
+                .level = level
+            };
+            slot->settled++;
+            deliver(slot, &event);
+        }
+    }
+    //rounded up so that the task does not wake before the window ends
+    TickType_t ticks = ((next_us - now) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    return (ticks > 0) ? ticks : 1;
+}
+
+static void gpio_events_task(void *pvParameters)
+{
+    //the timeout lets the rate fall to 0 when the pins go quiet
+    TickType_t wait = 1000 / portTICK_PERIOD_MS;
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, wait);
+        while(g_tail != g_head)
+        {
+            __sync_synchronize();
+            event_record_t record = g_ring[g_tail & (GPIO_EVENTS_RING_SIZE - 1)];
+            g_tail++;
+            pin_slot_t *slot = &g_slots[record.slot];
+            deliver(slot, &record.event);
+            if((slot->type == GPIO_INTR_ANYEDGE) && (slot->debounce_us != 0))
+            {
+                slot->settle_pending = true;
+                slot->settle_us = record.event.time_us + slot->debounce_us;
+            }
+        }
+        int64_t now = esp_timer_get_time();
+        update_rates(now);
+        wait = settle_pins(now);
+    }
+}
+
+void gpio_events_init(void)
+{
+    if(g_events_task != NULL)
+    {
+        return;
+    }
+    esp_err_t res = gpio_install_isr_service(0);
+    if((res != ESP_OK) && (res != ESP_ERR_INVALID_STATE))
+    {
+        ESP_LOGE(TAG, "gpio_install_isr_service() failed (%d)", res);
+        return;
+    }
+    xTaskCreate(&gpio_events_task, "gpio_events", 3072, NULL, GPIO_EVENTS_TASK_PRIORITY, &g_events_task);
+}
+
+bool gpio_events_add(gpio_num_t pin, gpio_int_type_t type, uint32_t debounce_us,
+                     gpio_event_handler_t handler, void *arg)
+{
+    if(g_events_task == NULL)
+    {
+        ESP_LOGE(TAG, "gpio_events_init() not called");
+        return false;
+    }
+    for(int i=0;i<g_nb_slots;i++)
+    {
+        if(g_slots[i].pin == pin)
+        {
+            ESP_LOGE(TAG, "pin %d already added", pin);
+            return false;
+        }
+    }
+    if(g_nb_slots == GPIO_EVENTS_MAX_PINS)
+    {
+        ESP_LOGE(TAG, "no slot left for pin %d, see GPIO_EVENTS_MAX_PINS", pin);
+        return false;
+    }
+    pin_slot_t *slot = &g_slots[g_nb_slots];
+    memset(slot, 0, sizeof(pin_slot_t));
+    slot->pin = pin;
+    slot->type = type;
+    slot->debounce_us = debounce_us;
+    slot->handler = handler;
+    slot->arg = arg;
+    slot->window_us = esp_timer_get_time();
+    //so that the first edge is never a bounce
+    slot->last_us = slot->window_us - debounce_us;
+    //counted before the ISR can fire, so that the task can reach the slot
+    g_nb_slots++;
+
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+    gpio_set_intr_type(pin, type);
+    if(gpio_isr_handler_add(pin, &gpio_events_isr, slot) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "gpio_isr_handler_add() failed for pin %d", pin);
+        gpio_set_intr_type(pin, GPIO_INTR_DISABLE);
+        g_nb_slots--;
+        return false;
+    }
+    gpio_intr_enable(pin);
+    ESP_LOGI(TAG, "pin %d added, debounce %u us", pin, debounce_us);
+    return true;
+}
+
+bool gpio_events_get_stats(gpio_num_t pin, gpio_event_stats_t *stats)
+{
+    for(int i=0;i<g_nb_slots;i++)
+    {
+        if(g_slots[i].pin == pin)
+        {
+            stats->events = g_slots[i].events;
+            stats->bounces = g_slots[i].bounces;
+            stats->dropped = g_slots[i].dropped;
+            stats->rate = g_slots[i].rate;
+            stats->settled = g_slots[i].settled;
+            return true;
+        }
+    }
+    return false;
+}
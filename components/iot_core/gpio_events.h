@@ -0,0 +1,97 @@
+/*
+ * gpio_events.h
+ *
+ * Interrupt driven input pins, instead of polling them from a task loop.
+ *
+ * The ISR of a pin only reads the level and esp_timer_get_time(), drops the
+ * edges closer than the debounce time to the last accepted one, and pushes a
+ * record in a single producer ring (all the pins share the ISR service, so
+ * the pushes never run concurrently). A task drains the ring and calls the
+ * handler of each pin with the record, outside of the interrupt.
+ *
+ * The edges of a bounce that come after the accepted one are all dropped, the
+ * last one included, so for a pin captured on GPIO_INTR_ANYEDGE the task reads
+ * the pin again when the debounce time is over and gives the settled level to
+ * the handler if it is not the last one it got.
+ *
+ * Per pin statistics count the accepted events, the bounces, the records
+ * dropped because the ring was full and the rate of the last second, e.g. the
+ * speed of a tachometer.
+ *
+ * @code{.c}
+ * gpio_events_init();
+ * gpio_events_add(GPIO_NUM_0, GPIO_INTR_NEGEDGE, 20000, &on_button, NULL);
+ * ...
+ * static void on_button(const gpio_event_t *event, void *arg)
+ * {
+ *     ESP_LOGI(TAG, "button> pressed at %lld us", event->time_us);
+ * }
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_GPIO_EVENTS_H_
+#define COMPONENTS_IOT_CORE_GPIO_EVENTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//number of records, a power of 2
+#ifndef GPIO_EVENTS_RING_SIZE
+#define GPIO_EVENTS_RING_SIZE 32
+#endif
+
+#ifndef GPIO_EVENTS_MAX_PINS
+#define GPIO_EVENTS_MAX_PINS 8
+#endif
+
+#ifndef GPIO_EVENTS_TASK_PRIORITY
+#define GPIO_EVENTS_TASK_PRIORITY 10
+#endif
+
+typedef struct {
+    int64_t     time_us;    //esp_timer_get_time() when the level was read
+    uint8_t     pin;
+    uint8_t     level;      //level read in the ISR after the edge, or by the task when settled
+} gpio_event_t;
+
+//called from the events task, not from the ISR
+typedef void (*gpio_event_handler_t)(const gpio_event_t *event, void *arg);
+
+typedef struct {
+    uint32_t    events;     //accepted and queued
+    uint32_t    bounces;    //rejected by the debounce
+    uint32_t    dropped;    //accepted but the ring was full
+    uint32_t    rate;       //events in the last complete second
+    uint32_t    settled;    //levels read at the end of a debounce, ANYEDGE only
+} gpio_event_stats_t;
+
+/**
+ * @brief install the GPIO ISR service and start the events task
+ */
+void gpio_events_init(void);
+
+/**
+ * @brief set the pin as input and deliver its edges to the handler
+ * @param [in] type the edges to capture, GPIO_INTR_POSEDGE, NEGEDGE or ANYEDGE
+ * @param [in] debounce_us edges closer than this to the last accepted one are ignored, 0 for none
+ * @return false if the pin is already used or GPIO_EVENTS_MAX_PINS are used
+ */
+bool gpio_events_add(gpio_num_t pin, gpio_int_type_t type, uint32_t debounce_us,
+                     gpio_event_handler_t handler, void *arg);
+
+/**
+ * @brief copy the statistics of the pin, the counters are not read atomically together
+ * @return false if the pin was not added
+ */
+bool gpio_events_get_stats(gpio_num_t pin, gpio_event_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_GPIO_EVENTS_H_ */
@@ -0,0 +1,107 @@
+// Replays traces of ADC bursts through the battery filter
+//
+// A trace has one burst of BATTERY_BURST_SAMPLES raw codes per line, the
+// filtered code after the last burst is checked by the lines
+//   expect <min> <max>
+// and the lines starting with # are comments.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "battery_monitor.h"
+#include "host_test.h"
+
+static void replay(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+    {
+        printf("FAIL cannot open %s\n", path);
+        host_test_failures++;
+        return;
+    }
+    battery_filter_t filter;
+    battery_filter_init(&filter);
+    uint16_t filtered = 0;
+    int bursts = 0;
+    int checks = 0;
+    int line_nb = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        line_nb++;
+        int min, max;
+        if((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+        if(sscanf(line, "expect %d %d", &min, &max) == 2)
+        {
+            if((bursts == 0) || (filtered < min) || (filtered > max))
+            {
+                printf("FAIL %s:%d filtered %u after %d bursts, expected %d..%d\n",
+                        path, line_nb, filtered, bursts, min, max);
+                host_test_failures++;
+            }
+            checks++;
+            continue;
+        }
+        uint16_t samples[BATTERY_BURST_SAMPLES];
+        int nb = 0;
+        char *next = line;
+        char *end;
+        for(long value = strtol(next, &end, 10); end != next; value = strtol(next, &end, 10))
+        {
+            if(nb < BATTERY_BURST_SAMPLES)
+            {
+                samples[nb] = (uint16_t)value;
+            }
+            nb++;
+            next = end;
+        }
+        if(nb != BATTERY_BURST_SAMPLES)
+        {
+            printf("FAIL %s:%d %d samples, expected %d\n", path, line_nb, nb, BATTERY_BURST_SAMPLES);
+            host_test_failures++;
+            continue;
+        }
+        filtered = battery_filter_push(&filter, battery_burst_reduce(samples, nb));
+        bursts++;
+    }
+    fclose(file);
+    printf("%s: %d bursts, %d checks, last filtered %u\n", path, bursts, checks, filtered);
+}
+
+static void check_reduce(void)
+{
+    //the quarter of the samples on each side is ignored
+    uint16_t samples[8] = {900, 10, 100, 101, 103, 102, 5000, 0};
+    CHECK(battery_burst_reduce(samples, 8) == 102);
+    for(int i=1;i<8;i++)
+    {
+        CHECK(samples[i-1] <= samples[i]);
+    }
+    //a single burst off the others is rejected by the median
+    battery_filter_t filter;
+    battery_filter_init(&filter);
+    battery_filter_push(&filter, 2000);
+    battery_filter_push(&filter, 2000);
+    CHECK(battery_filter_push(&filter, 2000) == 2000);
+    CHECK(battery_filter_push(&filter, 1000) == 2000);
+    CHECK(battery_filter_push(&filter, 2000) == 2000);
+}
+
+int main(int argc, char **argv)
+{
+    check_reduce();
+    if(argc < 2)
+    {
+        printf("FAIL no trace given\n");
+        host_test_failures++;
+    }
+    for(int i=1;i<argc;i++)
+    {
+        replay(argv[i]);
+    }
+    return host_test_result();
+}
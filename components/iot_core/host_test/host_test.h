@@ -0,0 +1,47 @@
+// Shared helpers of the host checks and benchmarks of all the projects, the
+// Makefiles of the other host_test directories add this directory to the
+// include path
+
+#pragma once
+
+#include <stdio.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(condition)                                              \
+  do {                                                                \
+    if (!(condition)) {                                               \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #condition);      \
+      host_test_failures++;                                           \
+    }                                                                 \
+  } while (0)
+
+static int host_test_result(void) {
+  printf("%s, %d failure(s)\n", host_test_failures ? "FAILED" : "passed",
+         host_test_failures);
+  return host_test_failures ? 1 : 0;
+}
+
+#ifdef __cplusplus
+
+#include <chrono>
+
+// best time of a few runs of `repeat` calls, in nanoseconds per call, so that
+// a preemption of the host does not show in the result
+template <typename TFunction>
+double best_ns(TFunction function, int repeat, int runs = 15) {
+  double best = 1e18;
+  for (int run = 0; run < runs; run++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) function();
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start)
+                    .count() /
+                repeat;
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+#endif
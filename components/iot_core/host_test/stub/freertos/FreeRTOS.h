@@ -0,0 +1,9 @@
+// host declarations of the IDF, the task is never started on the host
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portTICK_PERIOD_MS 10
@@ -0,0 +1,11 @@
+// host declarations of the IDF, defined in host_stubs.c
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *handle);
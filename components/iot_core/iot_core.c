@@ -0,0 +1,352 @@
+/*
+ * iot_core.c
+ *
+ * see iot_core.h
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "esp_wifi.h"
+#include "esp_event_loop.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "freertos/semphr.h"
+
+#include "iot_core.h"
+#include "boot_timeline.h"
+#include "log_ring.h"
+
+static const char *TAG = "iot_core";
+
+static const char *LWT_MESSAGE = "offline";
+
+#define WIFI_CACHE_MAGIC 0x57494649
+
+//the access point of the last association, kept in RTC memory over deep sleep
+typedef struct {
+    uint32_t    magic;
+    uint8_t     bssid[6];
+    uint8_t     channel;
+} wifi_cache_t;
+
+static RTC_DATA_ATTR wifi_cache_t g_wifi_cache;
+static wifi_config_t g_wifi_config;
+static bool g_fast_connect = false;
+
+EventGroupHandle_t iot_event_group = NULL;
+
+static esp_mqtt_client_handle_t g_client = NULL;
+static bool g_client_started = false;
+static portMUX_TYPE g_start_mux = portMUX_INITIALIZER_UNLOCKED;
+static const char *g_status_topic = NULL;
+static const char *g_sub_topic = NULL;
+static const topic_router_t *g_router = NULL;
+static bool g_got_ip_once = false;
+static bool g_connected_once = false;
+static bool g_persistent_session = false;
+static int g_buffer_size = 0;
+
+static SemaphoreHandle_t g_publish_mutex = NULL;
+static SemaphoreHandle_t g_boot_mutex = NULL;
+static char g_publish_buffer[IOT_PUBLISH_BUFFER_SIZE];
+
+//the client is started by whichever comes last of iot_mqtt_start() and the first IP
+static void mqtt_client_start_once(void)
+{
+    bool do_start = false;
+    portENTER_CRITICAL(&g_start_mux);
+    if(g_client && !g_client_started)
+    {
+        g_client_started = true;
+        do_start = true;
+    }
+    portEXIT_CRITICAL(&g_start_mux);
+    if(do_start)
+    {
+        esp_mqtt_client_start(g_client);
+    }
+}
+
+static esp_err_t wifi_event_handler(void *ctx, system_event_t *event)
+{
+    switch (event->event_id) {
+        case SYSTEM_EVENT_STA_START:
+            esp_wifi_connect();
+            break;
+        case SYSTEM_EVENT_STA_CONNECTED:
+            memcpy(g_wifi_cache.bssid, event->event_info.connected.bssid, sizeof(g_wifi_cache.bssid));
+            g_wifi_cache.channel = event->event_info.connected.channel;
+            g_wifi_cache.magic = WIFI_CACHE_MAGIC;
+            break;
+        case SYSTEM_EVENT_STA_GOT_IP:
+            xEventGroupSetBits(iot_event_group, IOT_WIFI_CONNECTED_BIT);
+            g_fast_connect = false;
+            if(!g_got_ip_once)
+            {
+                g_got_ip_once = true;
+                boot_timeline_mark("wifi got ip");
+            }
+            //started once, the client handles its own reconnections
+            mqtt_client_start_once();
+            break;
+        case SYSTEM_EVENT_STA_DISCONNECTED:
+            if(g_fast_connect)
+            {
+                //the access point moved or is gone, back to a full scan of the SSID
+                ESP_LOGW(TAG, "fast connect to the cached access point failed");
+                g_fast_connect = false;
+                g_wifi_cache.magic = 0;
+                g_wifi_config.sta.bssid_set = false;
+                g_wifi_config.sta.channel = 0;
+                esp_wifi_set_config(ESP_IF_WIFI_STA, &g_wifi_config);
+            }
+            esp_wifi_connect();
+            xEventGroupClearBits(iot_event_group, IOT_WIFI_CONNECTED_BIT);
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+void iot_wifi_init(void)
+{
+    tcpip_adapter_init();
+    iot_event_group = xEventGroupCreate();
+    g_boot_mutex = xSemaphoreCreateMutex();
+    ESP_ERROR_CHECK(esp_event_loop_init(wifi_event_handler, NULL));
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    memset(&g_wifi_config, 0, sizeof(wifi_config_t));
+    strncpy((char *)g_wifi_config.sta.ssid, CONFIG_WIFI_SSID, sizeof(g_wifi_config.sta.ssid));
+    strncpy((char *)g_wifi_config.sta.password, CONFIG_WIFI_PASSWORD, sizeof(g_wifi_config.sta.password));
+    //after a deep sleep the last access point is joined directly, without scanning all the channels
+    if(g_wifi_cache.magic == WIFI_CACHE_MAGIC)
+    {
+        g_wifi_config.sta.bssid_set = true;
+        memcpy(g_wifi_config.sta.bssid, g_wifi_cache.bssid, sizeof(g_wifi_config.sta.bssid));
+        g_wifi_config.sta.channel = g_wifi_cache.channel;
+        g_fast_connect = true;
+    }
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &g_wifi_config));
+    ESP_LOGI(TAG, "start the WIFI SSID:[%s]%s", CONFIG_WIFI_SSID, g_fast_connect ? " on the cached channel" : "");
+    ESP_ERROR_CHECK(esp_wifi_start());
+    boot_timeline_mark("wifi started");
+}
+
+bool iot_wifi_wait(TickType_t ticks_to_wait)
+{
+    ESP_LOGI(TAG, "Waiting for wifi");
+    EventBits_t bits = xEventGroupWaitBits(iot_event_group, IOT_WIFI_CONNECTED_BIT, false, true, ticks_to_wait);
+    return (bits & IOT_WIFI_CONNECTED_BIT) != 0;
+}
+
+static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
+{
+    int msg_id;
+    switch (event->event_id) {
+        case MQTT_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+            xEventGroupSetBits(iot_event_group, IOT_MQTT_CONNECTED_BIT);
+            if(!g_connected_once)
+            {
+                g_connected_once = true;
+                boot_timeline_mark("mqtt connected");
+                boot_timeline_log();
+            }
+            msg_id = esp_mqtt_client_publish(event->client, g_status_topic, "online", 0, 1, 1);
+            ESP_LOGI(TAG, "MQTT> sent publish successful, msg_id=%d", msg_id);
+            if(g_sub_topic)
+            {
+                //QoS 1 so that the broker keeps the messages of a persistent session while offline
+                msg_id = esp_mqtt_client_subscribe(event->client, g_sub_topic, g_persistent_session ? 1 : 0);
+                ESP_LOGI(TAG, "MQTT> sent subscribe successful, msg_id=%d", msg_id);
+            }
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+            xEventGroupClearBits(iot_event_group, IOT_MQTT_CONNECTED_BIT);
+            break;
+        case MQTT_EVENT_SUBSCRIBED:
+            break;
+        case MQTT_EVENT_UNSUBSCRIBED:
+            ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            ESP_LOGD(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            break;
+        case MQTT_EVENT_DATA:
+            //a message larger than the client buffer comes in several events, it is dropped rather than parsed truncated
+            if(event->total_data_len > event->data_len)
+            {
+                if(event->current_data_offset == 0)
+                {
+                    LOG_RING_TEXT_I(TAG, "MQTT> topic %s dropped, %d bytes over the buffer", event->topic, event->topic_len, event->total_data_len);
+                }
+                break;
+            }
+            LOG_RING_TEXT_I(TAG, "MQTT> topic %s (%d bytes)", event->topic, event->topic_len, event->data_len);
+            //set before the dispatch, after the running self-test step, so that the self-test cannot overwrite the command
+            if(!(xEventGroupGetBits(iot_event_group) & IOT_COMMAND_BIT))
+            {
+                xSemaphoreTake(g_boot_mutex, portMAX_DELAY);
+                xEventGroupSetBits(iot_event_group, IOT_COMMAND_BIT);
+                xSemaphoreGive(g_boot_mutex);
+                boot_timeline_mark("first command");
+            }
+            if(!g_router || !topic_router_dispatch(g_router, event->topic, event->topic_len, event->data, event->data_len))
+            {
+                LOG_RING_TEXT_I(TAG, "MQTT> unhandled topic %s", event->topic, event->topic_len);
+            }
+            break;
+        case MQTT_EVENT_ERROR:
+            ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
+            break;
+    }
+    return ESP_OK;
+}
+
+void iot_mqtt_start(const char *status_topic, const char *sub_topic, const topic_router_t *router)
+{
+    g_status_topic = status_topic;
+    g_sub_topic = sub_topic;
+    g_router = router;
+    g_publish_mutex = xSemaphoreCreateMutex();
+
+    esp_mqtt_client_config_t mqtt_cfg;
+    memset(&mqtt_cfg,0,sizeof(esp_mqtt_client_config_t));
+    mqtt_cfg.uri = CONFIG_BROKER_URL;
+    mqtt_cfg.event_handle = mqtt_event_handler;
+    mqtt_cfg.lwt_topic = status_topic;
+    mqtt_cfg.lwt_msg = LWT_MESSAGE;
+    mqtt_cfg.lwt_msg_len = strlen(LWT_MESSAGE);
+    mqtt_cfg.lwt_qos = 1;
+    mqtt_cfg.lwt_retain = 1;
+    mqtt_cfg.disable_clean_session = g_persistent_session;
+    mqtt_cfg.buffer_size = g_buffer_size;
+
+    esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+    portENTER_CRITICAL(&g_start_mux);
+    g_client = client;
+    portEXIT_CRITICAL(&g_start_mux);
+    if(xEventGroupGetBits(iot_event_group) & IOT_WIFI_CONNECTED_BIT)
+    {
+        mqtt_client_start_once();
+    }
+}
+
+void iot_mqtt_persistent_session(void)
+{
+    g_persistent_session = true;
+}
+
+void iot_mqtt_buffer_size(int size)
+{
+    g_buffer_size = size;
+}
+
+void iot_mqtt_stop(void)
+{
+    if(g_client && g_client_started)
+    {
+        esp_mqtt_client_stop(g_client);
+    }
+    xEventGroupClearBits(iot_event_group, IOT_MQTT_CONNECTED_BIT);
+}
+
+bool iot_mqtt_is_ready(void)
+{
+    return (iot_event_group != NULL) && (xEventGroupGetBits(iot_event_group) & IOT_MQTT_CONNECTED_BIT);
+}
+
+bool iot_boot_begin(void)
+{
+    xSemaphoreTake(g_boot_mutex, portMAX_DELAY);
+    if(xEventGroupGetBits(iot_event_group) & IOT_COMMAND_BIT)
+    {
+        xSemaphoreGive(g_boot_mutex);
+        return false;
+    }
+    return true;
+}
+
+bool iot_boot_delay_ms(int delay_ms)
+{
+    xSemaphoreGive(g_boot_mutex);
+    EventBits_t bits = xEventGroupWaitBits(iot_event_group, IOT_COMMAND_BIT, false, true, delay_ms / portTICK_PERIOD_MS);
+    if(bits & IOT_COMMAND_BIT)
+    {
+        return false;
+    }
+    return iot_boot_begin();
+}
+
+void iot_boot_end(void)
+{
+    xSemaphoreGive(g_boot_mutex);
+}
+
+esp_mqtt_client_handle_t iot_mqtt_client(void)
+{
+    return g_client;
+}
+
+int iot_publish(const char *topic, const char *payload, int len, int qos, int retain)
+{
+    if(!iot_mqtt_is_ready())
+    {
+        ESP_LOGW(TAG, "mqtt client not ready");
+        return -1;
+    }
+    return esp_mqtt_client_publish(g_client, topic, payload, len, qos, retain);
+}
+
+int iot_publishf(const char *topic, int qos, int retain, const char *fmt, ...)
+{
+    char *buffer = iot_publish_buffer_take();
+    if(buffer == NULL)
+    {
+        return -1;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buffer, IOT_PUBLISH_BUFFER_SIZE, fmt, args);
+    va_end(args);
+    if((len < 0) || (len >= IOT_PUBLISH_BUFFER_SIZE))
+    {
+        ESP_LOGE(TAG, "payload for '%s' does not fit in IOT_PUBLISH_BUFFER_SIZE", topic);
+        len = -1;
+    }
+    return iot_publish_buffer_give(topic, len, qos, retain);
+}
+
+char *iot_publish_buffer_take(void)
+{
+    if(!iot_mqtt_is_ready())
+    {
+        ESP_LOGW(TAG, "mqtt client not ready");
+        return NULL;
+    }
+    xSemaphoreTake(g_publish_mutex, portMAX_DELAY);
+    return g_publish_buffer;
+}
+
+int iot_publish_buffer_give(const char *topic, int len, int qos, int retain)
+{
+    int msg_id = -1;
+    if(len >= 0)
+    {
+        //the client takes strlen() of a 0 length, the buffer still holds the previous payload
+        if(len == 0)
+        {
+            g_publish_buffer[0] = 0;
+        }
+        msg_id = esp_mqtt_client_publish(g_client, topic, g_publish_buffer, len, qos, retain);
+    }
+    xSemaphoreGive(g_publish_mutex);
+    return msg_id;
+}
@@ -0,0 +1,160 @@
+/*
+ * iot_core.h
+ *
+ * Wifi station and MQTT connection manager shared by the firmware apps.
+ *
+ * The apps only provide their status topic, their subscription and a topic
+ * router, the connection handling is the same for all of them :
+ *  - the last will "offline" and the "online" message on connect are both
+ *    retained on the status topic
+ *  - the subscription is renewed on every (re)connection
+ *  - received messages are dispatched through the router
+ *
+ * Nothing here blocks on the network : iot_mqtt_start() only registers the
+ * client, which is started from the wifi event handler on the first IP, so
+ * the apps can initialise their hardware while the station associates.
+ * The connection stages are recorded in the boot timeline.
+ *
+ * The channel and BSSID of the access point are kept in RTC memory, after a
+ * deep sleep the station joins it directly instead of scanning, and falls
+ * back to the scan if that fails.
+ *
+ * Publishing goes through a single preallocated payload buffer, guarded by
+ * a mutex, so that formatting a value does not need a stack array per call
+ * and concurrent publishers from different tasks are serialised.
+ *
+ * @code{.c}
+ * iot_wifi_init();
+ * iot_mqtt_start("esp/motor/status", "esp/motor/pwm", &router);
+ * ...
+ * iot_publishf("esp/motor/status", 1, 0, "%d", val);
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_IOT_CORE_H_
+#define COMPONENTS_IOT_CORE_IOT_CORE_H_
+
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "mqtt_client.h"
+
+#include "topic_router.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef IOT_PUBLISH_BUFFER_SIZE
+#define IOT_PUBLISH_BUFFER_SIZE 256
+#endif
+
+#define IOT_WIFI_CONNECTED_BIT  BIT0
+#define IOT_MQTT_CONNECTED_BIT  BIT1
+#define IOT_COMMAND_BIT         BIT2    //set once the first message was received
+
+extern EventGroupHandle_t iot_event_group;
+
+/**
+ * @brief start the wifi station with CONFIG_WIFI_SSID, does not wait for the connection
+ */
+void iot_wifi_init(void);
+
+/**
+ * @brief wait until the station got an IP
+ * @return false on timeout
+ */
+bool iot_wifi_wait(TickType_t ticks_to_wait);
+
+/**
+ * @brief start the MQTT client on CONFIG_BROKER_URL as soon as the station has an IP, does not block
+ * @param [in] status_topic last will "offline" and "online" on connect, not copied
+ * @param [in] sub_topic subscribed on every connection, NULL for none, not copied
+ * @param [in] router used to dispatch the received messages, NULL for none
+ */
+void iot_mqtt_start(const char *status_topic, const char *sub_topic, const topic_router_t *router);
+
+/**
+ * @brief to call before iot_mqtt_start(), the broker keeps the session and the
+ * QoS 1 subscription over the disconnections, for nodes that sleep between events
+ */
+void iot_mqtt_persistent_session(void);
+
+/**
+ * @brief to call before iot_mqtt_start(), the client buffer holds a whole
+ * received message with its topic, bigger messages are dropped
+ * @param [in] size in bytes, the client default is 1024
+ */
+void iot_mqtt_buffer_size(int size);
+
+/**
+ * @brief stop the client before sleeping, the broker publishes the last will
+ */
+void iot_mqtt_stop(void);
+
+bool iot_mqtt_is_ready(void);
+
+/**
+ * @brief start a self-test, its steps run under a lock that the first received
+ * command waits for, so that a step cannot overwrite the command
+ * @code{.c}
+ * if(!iot_boot_begin())
+ *     return;
+ * show_step(1);
+ * if(!iot_boot_delay_ms(500))
+ *     return;
+ * show_step(2);
+ * iot_boot_end();
+ * @endcode
+ * @return false if a command was already received, the lock is then not held
+ */
+bool iot_boot_begin(void);
+
+/**
+ * @brief delay between two self-test steps, the lock is released meanwhile
+ * @return false if a command was received, the self-test should then stop
+ * driving the hardware, the lock is then not held
+ */
+bool iot_boot_delay_ms(int delay_ms);
+
+/**
+ * @brief release the lock after the last self-test step
+ */
+void iot_boot_end(void);
+
+esp_mqtt_client_handle_t iot_mqtt_client(void);
+
+/**
+ * @brief publish a payload if the client is connected
+ * @param [in] len payload length, 0 for a null terminated payload
+ * @return the msg_id, -1 if not connected
+ */
+int iot_publish(const char *topic, const char *payload, int len, int qos, int retain);
+
+/**
+ * @brief format the payload in the shared publish buffer and publish it
+ * @return the msg_id, -1 if not connected or if the payload does not fit
+ */
+int iot_publishf(const char *topic, int qos, int retain, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief take the shared publish buffer to build a payload in place, see telemetry.h
+ * @return the buffer of IOT_PUBLISH_BUFFER_SIZE bytes, NULL if not connected,
+ * the buffer must then be given back with iot_publish_buffer_give()
+ */
+char *iot_publish_buffer_take(void);
+
+/**
+ * @brief publish the payload built in the taken buffer and give the buffer back
+ * @param [in] len payload length, 0 for an empty payload, negative to give the buffer back without publishing
+ * @return the msg_id, -1 if nothing was published
+ */
+int iot_publish_buffer_give(const char *topic, int len, int qos, int retain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_IOT_CORE_H_ */
@@ -0,0 +1,213 @@
+/*
+ * log_ring.c
+ *
+ * see log_ring.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "log_ring.h"
+
+static const char *TAG = "log_ring";
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0
+#error "LOG_RING_SIZE must be a power of 2"
+#endif
+
+typedef struct {
+    uint32_t        time_ms;
+    const char     *tag;
+    const char     *fmt;
+    uint32_t        args[4];
+    uint8_t         level;
+    uint8_t         has_text;
+    char            text[LOG_RING_TEXT_SIZE];
+} log_record_t;
+
+typedef struct {
+    const char     *tag;
+    int32_t         tokens;     //in thousandths of a record
+    uint32_t        last_ms;
+} tag_bucket_t;
+
+static log_record_t g_ring[LOG_RING_SIZE];
+static uint32_t g_head = 0;     //next record to write
+static uint32_t g_tail = 0;     //next record to drain
+static uint32_t g_dropped = 0;
+static tag_bucket_t g_buckets[LOG_RING_MAX_TAGS];
+static int g_nb_buckets = 0;
+static portMUX_TYPE g_ring_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t g_drain_task = NULL;
+
+//called in the critical section
+static bool take_token(const char *tag, uint32_t now)
+{
+    tag_bucket_t *bucket = NULL;
+    for(int i=0;i<g_nb_buckets;i++)
+    {
+        if(g_buckets[i].tag == tag)
+        {
+            bucket = &g_buckets[i];
+            break;
+        }
+    }
+    if(bucket == NULL)
+    {
+        if(g_nb_buckets == LOG_RING_MAX_TAGS)
+        {
+            return true;
+        }
+        bucket = &g_buckets[g_nb_buckets++];
+        bucket->tag = tag;
+        bucket->tokens = LOG_RING_TAG_BURST * 1000;
+        bucket->last_ms = now;
+    }
+    uint32_t elapsed = now - bucket->last_ms;
+    bucket->last_ms = now;
+    if(elapsed > LOG_RING_TAG_BURST * 1000 / LOG_RING_TAG_RATE)
+    {
+        bucket->tokens = LOG_RING_TAG_BURST * 1000;
+    }
+    else
+    {
+        bucket->tokens += elapsed * LOG_RING_TAG_RATE;
+        if(bucket->tokens > LOG_RING_TAG_BURST * 1000)
+        {
+            bucket->tokens = LOG_RING_TAG_BURST * 1000;
+        }
+    }
+    if(bucket->tokens < 1000)
+    {
+        return false;
+    }
+    bucket->tokens -= 1000;
+    return true;
+}
+
+//returns the record to fill in the critical section, NULL if dropped
+static log_record_t *reserve(esp_log_level_t level, const char *tag, const char *fmt, uint32_t now)
+{
+    if(!take_token(tag, now) || ((g_head - g_tail) == LOG_RING_SIZE))
+    {
+        g_dropped++;
+        return NULL;
+    }
+    log_record_t *record = &g_ring[g_head & (LOG_RING_SIZE - 1)];
+    g_head++;
+    record->time_ms = now;
+    record->tag = tag;
+    record->fmt = fmt;
+    record->level = level;
+    return record;
+}
+
+void log_ring_push(esp_log_level_t level, const char *tag, const char *fmt,
+                   uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t now = esp_log_timestamp();
+    portENTER_CRITICAL(&g_ring_mux);
+    log_record_t *record = reserve(level, tag, fmt, now);
+    if(record)
+    {
+        record->args[0] = a0;
+        record->args[1] = a1;
+        record->args[2] = a2;
+        record->args[3] = a3;
+        record->has_text = 0;
+    }
+    portEXIT_CRITICAL(&g_ring_mux);
+}
+
+void log_ring_push_text(esp_log_level_t level, const char *tag, const char *fmt,
+                        const char *text, int len, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+    uint32_t now = esp_log_timestamp();
+    if(len > LOG_RING_TEXT_SIZE - 1)
+    {
+        len = LOG_RING_TEXT_SIZE - 1;
+    }
+    portENTER_CRITICAL(&g_ring_mux);
+    log_record_t *record = reserve(level, tag, fmt, now);
+    if(record)
+    {
+        record->args[0] = a0;
+        record->args[1] = a1;
+        record->args[2] = a2;
+        record->has_text = 1;
+        memcpy(record->text, text, len);
+        record->text[len] = 0;
+    }
+    portEXIT_CRITICAL(&g_ring_mux);
+}
+
+uint32_t log_ring_dropped(void)
+{
+    return g_dropped;
+}
+
+static char level_letter(uint8_t level)
+{
+    switch(level)
+    {
+        case ESP_LOG_ERROR:     return 'E';
+        case ESP_LOG_WARN:      return 'W';
+        case ESP_LOG_INFO:      return 'I';
+        case ESP_LOG_DEBUG:     return 'D';
+        default:                return 'V';
+    }
+}
+
+static void drain_task(void *pvParameter)
+{
+    static char line[128];
+    uint32_t reported_drops = 0;
+    while(1)
+    {
+        log_record_t record;
+        bool available = false;
+        portENTER_CRITICAL(&g_ring_mux);
+        if(g_tail != g_head)
+        {
+            record = g_ring[g_tail & (LOG_RING_SIZE - 1)];
+            g_tail++;
+            available = true;
+        }
+        portEXIT_CRITICAL(&g_ring_mux);
+
+        if(!available)
+        {
+            uint32_t dropped = g_dropped;
+            if(dropped != reported_drops)
+            {
+                ESP_LOGW(TAG, "%u records dropped (total %u)", dropped - reported_drops, dropped);
+                reported_drops = dropped;
+            }
+            vTaskDelay(LOG_RING_DRAIN_PERIOD_MS / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        if(record.has_text)
+        {
+            snprintf(line, sizeof(line), record.fmt, record.text, record.args[0], record.args[1], record.args[2]);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), record.fmt, record.args[0], record.args[1], record.args[2], record.args[3]);
+        }
+        esp_log_write((esp_log_level_t)record.level, record.tag, "%c (%u) %s: %s\n",
+                        level_letter(record.level), record.time_ms, record.tag, line);
+    }
+}
+
+void log_ring_init(void)
+{
+    if(g_drain_task == NULL)
+    {
+        xTaskCreate(&drain_task, "log_ring", 2048, NULL, tskIDLE_PRIORITY + 1, &g_drain_task);
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * log_ring.h
+ *
+ * Deferred logging for the hot paths (MQTT handlers, per pixel loops).
+ *
+ * A log call only stores a compact record in a ring : the format pointer,
+ * up to four integer arguments and optionally a short copy of a text that
+ * does not outlive the call (a topic, a payload). No formatting and no UART
+ * write happens in the caller, a low priority task formats and drains the
+ * records later.
+ *
+ * Each tag is rate limited with a token bucket, records over the rate or
+ * that do not fit in the ring are dropped and counted, the drain task
+ * reports the drops count so that a missing line is never silent.
+ *
+ * Restrictions :
+ *  - the format and the tag must be static strings
+ *  - the arguments are cast to uint32_t, only integer conversions (%d %u %x %c)
+ *  - at most 4 arguments, plus the text for the _TEXT variants which must be
+ *    consumed by the first conversion of the format ("%s")
+ *
+ * @code{.c}
+ * log_ring_init();
+ * LOG_RING_I(TAG, "rgb[%u](%u , %u , %u)", i, red, green, blue);
+ * LOG_RING_TEXT_I(TAG, "MQTT> topic %s (%d bytes)", event->topic, event->topic_len, event->data_len);
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_LOG_RING_H_
+#define COMPONENTS_IOT_CORE_LOG_RING_H_
+
+#include <stdint.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//number of records, a power of 2
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+//bytes copied from the text, longer texts are truncated
+#ifndef LOG_RING_TEXT_SIZE
+#define LOG_RING_TEXT_SIZE 32
+#endif
+
+//per tag token bucket, records per second and burst
+#ifndef LOG_RING_TAG_RATE
+#define LOG_RING_TAG_RATE 20
+#endif
+#ifndef LOG_RING_TAG_BURST
+#define LOG_RING_TAG_BURST 40
+#endif
+
+//number of distinct tags that can be rate limited, the extra tags are not limited
+#ifndef LOG_RING_MAX_TAGS
+#define LOG_RING_MAX_TAGS 8
+#endif
+
+#ifndef LOG_RING_DRAIN_PERIOD_MS
+#define LOG_RING_DRAIN_PERIOD_MS 50
+#endif
+
+/**
+ * @brief start the drain task, records pushed before are kept until the ring is full
+ */
+void log_ring_init(void);
+
+void log_ring_push(esp_log_level_t level, const char *tag, const char *fmt,
+                   uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/**
+ * @param [in] text copied, up to LOG_RING_TEXT_SIZE - 1 bytes
+ * @param [in] len text length, not null terminated
+ */
+void log_ring_push_text(esp_log_level_t level, const char *tag, const char *fmt,
+                        const char *text, int len, uint32_t a0, uint32_t a1, uint32_t a2);
+
+/**
+ * @brief number of records dropped since the start, rate limited or ring full
+ */
+uint32_t log_ring_dropped(void);
+
+//pads the arguments list with zeros, the format is always the first argument
+#define LOG_RING_ARGS_(fmt, a0, a1, a2, a3, ...)    fmt, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3)
+#define LOG_RING_ARGS(...)                          LOG_RING_ARGS_(__VA_ARGS__, 0, 0, 0, 0)
+#define LOG_RING_TEXT_ARGS_(fmt, t, l, a0, a1, a2, ...) fmt, t, l, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2)
+#define LOG_RING_TEXT_ARGS(...)                     LOG_RING_TEXT_ARGS_(__VA_ARGS__, 0, 0, 0)
+
+#define LOG_RING_LEVEL(level, tag, ...)      do { if (LOG_LOCAL_LEVEL >= level) log_ring_push(level, tag, LOG_RING_ARGS(__VA_ARGS__)); } while(0)
+#define LOG_RING_TEXT_LEVEL(level, tag, ...) do { if (LOG_LOCAL_LEVEL >= level) log_ring_push_text(level, tag, LOG_RING_TEXT_ARGS(__VA_ARGS__)); } while(0)
+
+#define LOG_RING_E(tag, ...)        LOG_RING_LEVEL(ESP_LOG_ERROR,   tag, __VA_ARGS__)
+#define LOG_RING_W(tag, ...)        LOG_RING_LEVEL(ESP_LOG_WARN,    tag, __VA_ARGS__)
+#define LOG_RING_I(tag, ...)        LOG_RING_LEVEL(ESP_LOG_INFO,    tag, __VA_ARGS__)
+#define LOG_RING_D(tag, ...)        LOG_RING_LEVEL(ESP_LOG_DEBUG,   tag, __VA_ARGS__)
+#define LOG_RING_TEXT_I(tag, ...)   LOG_RING_TEXT_LEVEL(ESP_LOG_INFO,  tag, __VA_ARGS__)
+#define LOG_RING_TEXT_D(tag, ...)   LOG_RING_TEXT_LEVEL(ESP_LOG_DEBUG, tag, __VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_LOG_RING_H_ */
@@ -0,0 +1,139 @@
+/*
+ * sleep_cycle.c
+ *
+ * see sleep_cycle.h
+ */
+
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "driver/rtc_io.h"
+
+#include "iot_core.h"
+#include "sleep_cycle.h"
+
+static const char *TAG = "sleep_cycle";
+
+#define SLEEP_CYCLE_MAGIC 0x534C4550
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    wakes;
+    uint32_t    awake_ms;   //previous wakes only
+    int32_t     wake_pin;   //of the last sleep, left on the RTC mux by the ext0 wake
+} sleep_counters_t;
+
+static RTC_DATA_ATTR sleep_counters_t g_counters;
+static sleep_wake_t g_cause = SLEEP_WAKE_POWER_ON;
+static volatile int64_t g_activity_us = 0;
+
+void sleep_cycle_init(void)
+{
+    switch(esp_sleep_get_wakeup_cause())
+    {
+        case ESP_SLEEP_WAKEUP_TIMER:
+            g_cause = SLEEP_WAKE_TIMER;
+            break;
+        case ESP_SLEEP_WAKEUP_EXT0:
+            g_cause = SLEEP_WAKE_GPIO;
+            break;
+        default:
+            g_cause = SLEEP_WAKE_POWER_ON;
+            break;
+    }
+    if((g_cause == SLEEP_WAKE_POWER_ON) || (g_counters.magic != SLEEP_CYCLE_MAGIC))
+    {
+        g_counters.magic = SLEEP_CYCLE_MAGIC;
+        g_counters.wakes = 0;
+        g_counters.awake_ms = 0;
+    }
+    else
+    {
+        g_counters.wakes++;
+        //on any wake, the pin was given to the RTC domain for the sleep, it has to
+        //be a digital pin again before the app reads it or adds its interrupt
+        if(g_counters.wake_pin != SLEEP_CYCLE_NO_PIN)
+        {
+            rtc_gpio_deinit((gpio_num_t)g_counters.wake_pin);
+        }
+    }
+    g_counters.wake_pin = SLEEP_CYCLE_NO_PIN;
+    g_activity_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "wake> %s, %u wakes, %u ms awake since power on",
+                    sleep_cycle_wake_name(g_cause), g_counters.wakes, g_counters.awake_ms);
+}
+
+sleep_wake_t sleep_cycle_wake_cause(void)
+{
+    return g_cause;
+}
+
+const char *sleep_cycle_wake_name(sleep_wake_t cause)
+{
+    switch(cause)
+    {
+        case SLEEP_WAKE_TIMER:  return "timer";
+        case SLEEP_WAKE_GPIO:   return "gpio";
+        default:                return "power on";
+    }
+}
+
+uint32_t sleep_cycle_wakes(void)
+{
+    return g_counters.wakes;
+}
+
+uint32_t sleep_cycle_awake_ms(void)
+{
+    return g_counters.awake_ms + sleep_cycle_since_wake_ms();
+}
+
+uint32_t sleep_cycle_since_wake_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void sleep_cycle_activity(void)
+{
+    g_activity_us = esp_timer_get_time();
+}
+
+uint32_t sleep_cycle_idle_ms(void)
+{
+    return (uint32_t)((esp_timer_get_time() - g_activity_us) / 1000);
+}
+
+void sleep_cycle_deep_sleep(uint32_t sleep_s, gpio_num_t wake_pin, int level)
+{
+    if(sleep_s != 0)
+    {
+        esp_sleep_enable_timer_wakeup((uint64_t)sleep_s * 1000000);
+    }
+    if(wake_pin != SLEEP_CYCLE_NO_PIN)
+    {
+        //the digital pull-ups are off in deep sleep, the RTC ones stay
+        if(level == 0)
+        {
+            rtc_gpio_pulldown_dis(wake_pin);
+            rtc_gpio_pullup_en(wake_pin);
+        }
+        else
+        {
+            rtc_gpio_pullup_dis(wake_pin);
+            rtc_gpio_pulldown_en(wake_pin);
+        }
+        esp_sleep_enable_ext0_wakeup(wake_pin, level);
+    }
+    g_counters.wake_pin = wake_pin;
+    iot_mqtt_stop();
+    esp_wifi_stop();
+    g_counters.awake_ms = sleep_cycle_awake_ms();
+    ESP_LOGI(TAG, "sleep> for %u s after %u ms awake", sleep_s, sleep_cycle_since_wake_ms());
+    esp_deep_sleep_start();
+}
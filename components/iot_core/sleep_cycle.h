@@ -0,0 +1,99 @@
+/*
+ * sleep_cycle.h
+ *
+ * Deep sleep between the events of a battery node.
+ *
+ * The node wakes on a timer or on a GPIO level (ext0, an RTC capable pin),
+ * does its work, stays awake while there is activity and goes back to deep
+ * sleep. The radio is stopped before sleeping, the wifi channel and BSSID
+ * cache of iot_core makes the next association fast.
+ *
+ * The ext0 wake leaves its pin on the RTC mux, sleep_cycle_init() gives it
+ * back to the GPIO matrix, so it has to run before the pin is read or gets
+ * its interrupt.
+ *
+ * The counters are kept in RTC memory over the deep sleeps. The time since
+ * the wake is esp_timer, restarted by the wake, so it does not include the
+ * ROM and bootloader startup.
+ *
+ * @code{.c}
+ * sleep_cycle_init();
+ * if(sleep_cycle_wake_cause() == SLEEP_WAKE_GPIO)
+ * {
+ *     ...
+ * }
+ * ...
+ * sleep_cycle_activity();
+ * ...
+ * if(sleep_cycle_idle_ms() > 2000)
+ * {
+ *     sleep_cycle_deep_sleep(600, GPIO_NUM_4, 0);
+ * }
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_SLEEP_CYCLE_H_
+#define COMPONENTS_IOT_CORE_SLEEP_CYCLE_H_
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLEEP_CYCLE_NO_PIN ((gpio_num_t)-1)
+
+typedef enum {
+    SLEEP_WAKE_POWER_ON,    //or any other reset
+    SLEEP_WAKE_TIMER,
+    SLEEP_WAKE_GPIO
+} sleep_wake_t;
+
+/**
+ * @brief reads the wake cause, counts the wake and gives the ext0 pin back to the GPIO matrix
+ */
+void sleep_cycle_init(void);
+
+sleep_wake_t sleep_cycle_wake_cause(void);
+
+const char *sleep_cycle_wake_name(sleep_wake_t cause);
+
+/**
+ * @return wakes from deep sleep since the power on
+ */
+uint32_t sleep_cycle_wakes(void);
+
+/**
+ * @return time awake since the power on, the current wake included
+ */
+uint32_t sleep_cycle_awake_ms(void);
+
+/**
+ * @return time since the wake
+ */
+uint32_t sleep_cycle_since_wake_ms(void);
+
+/**
+ * @brief postpones the sleep, to call on each command or event
+ */
+void sleep_cycle_activity(void);
+
+/**
+ * @return time since the last activity or since the wake
+ */
+uint32_t sleep_cycle_idle_ms(void);
+
+/**
+ * @brief stops MQTT and the wifi and enters deep sleep, does not return
+ * @param [in] sleep_s timer wake up, 0 for none
+ * @param [in] wake_pin RTC GPIO that wakes on the level, SLEEP_CYCLE_NO_PIN for none,
+ * it is pulled to the opposite level, it must not be at the level already or the node wakes at once
+ */
+void sleep_cycle_deep_sleep(uint32_t sleep_s, gpio_num_t wake_pin, int level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_SLEEP_CYCLE_H_ */
@@ -0,0 +1,162 @@
+/*
+ * telemetry.c
+ *
+ * see telemetry.h
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "iot_core.h"
+#include "telemetry.h"
+
+static const char *TAG = "telemetry";
+
+static void put_char(telemetry_t *doc, char c)
+{
+    //one byte is kept for the closing brace
+    if(doc->len < doc->size - 1)
+    {
+        doc->buffer[doc->len++] = c;
+    }
+    else
+    {
+        doc->overflow = true;
+    }
+}
+
+static void put_text(telemetry_t *doc, const char *text)
+{
+    while(*text)
+    {
+        put_char(doc, *text++);
+    }
+}
+
+static void put_uint(telemetry_t *doc, uint32_t value, int min_digits)
+{
+    char digits[10];
+    int nb = 0;
+    do
+    {
+        digits[nb++] = '0' + (value % 10);
+        value /= 10;
+    }while((value != 0) || (nb < min_digits));
+    while(nb)
+    {
+        put_char(doc, digits[--nb]);
+    }
+}
+
+static void put_key(telemetry_t *doc, const char *key)
+{
+    if(doc->buffer[doc->len - 1] != '{')
+    {
+        put_char(doc, ',');
+    }
+    put_char(doc, '"');
+    put_text(doc, key);
+    put_char(doc, '"');
+    put_char(doc, ':');
+}
+
+bool telemetry_begin(telemetry_t *doc)
+{
+    doc->buffer = iot_publish_buffer_take();
+    if(doc->buffer == NULL)
+    {
+        return false;
+    }
+    doc->size = IOT_PUBLISH_BUFFER_SIZE;
+    doc->len = 0;
+    doc->overflow = false;
+    put_char(doc, '{');
+    return true;
+}
+
+void telemetry_add_uint(telemetry_t *doc, const char *key, uint32_t value)
+{
+    put_key(doc, key);
+    put_uint(doc, value, 1);
+}
+
+void telemetry_add_int(telemetry_t *doc, const char *key, int32_t value)
+{
+    put_key(doc, key);
+    if(value < 0)
+    {
+        put_char(doc, '-');
+        put_uint(doc, 0u - (uint32_t)value, 1);
+    }
+    else
+    {
+        put_uint(doc, value, 1);
+    }
+}
+
+void telemetry_add_fixed(telemetry_t *doc, const char *key, int32_t value, int decimals)
+{
+    put_key(doc, key);
+    uint32_t magnitude = (uint32_t)value;
+    if(value < 0)
+    {
+        put_char(doc, '-');
+        magnitude = 0u - magnitude;
+    }
+    uint32_t scale = 1;
+    for(int i=0;i<decimals;i++)
+    {
+        scale *= 10;
+    }
+    put_uint(doc, magnitude / scale, 1);
+    if(decimals > 0)
+    {
+        put_char(doc, '.');
+        put_uint(doc, magnitude % scale, decimals);
+    }
+}
+
+void telemetry_add_bool(telemetry_t *doc, const char *key, bool value)
+{
+    put_key(doc, key);
+    put_text(doc, value ? "true" : "false");
+}
+
+void telemetry_add_string(telemetry_t *doc, const char *key, const char *value)
+{
+    put_key(doc, key);
+    if(value == NULL)
+    {
+        put_text(doc, "null");
+        return;
+    }
+    put_char(doc, '"');
+    for(;*value;value++)
+    {
+        char c = *value;
+        if((c == '"') || (c == '\\'))
+        {
+            put_char(doc, '\\');
+        }
+        else if((unsigned char)c < 0x20)
+        {
+            //control characters are dropped rather than escaped as \u00XX
+            continue;
+        }
+        put_char(doc, c);
+    }
+    put_char(doc, '"');
+}
+
+int telemetry_publish(telemetry_t *doc, const char *topic, int qos, int retain)
+{
+    //put_char() always keeps room for it
+    doc->buffer[doc->len++] = '}';
+    if(doc->overflow)
+    {
+        ESP_LOGE(TAG, "document for '%s' does not fit in IOT_PUBLISH_BUFFER_SIZE", topic);
+        return iot_publish_buffer_give(topic, -1, qos, retain);
+    }
+    return iot_publish_buffer_give(topic, doc->len, qos, retain);
+}
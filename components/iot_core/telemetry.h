@@ -0,0 +1,79 @@
+/*
+ * telemetry.h
+ *
+ * Builds a JSON object of several fields directly in the iot_core publish
+ * buffer and sends it as a single message, instead of one publish per value
+ * formatted in a stack array.
+ *
+ * The numbers are written digit by digit without printf, the fractional
+ * values are given as scaled integers (millivolts with 3 decimals are
+ * written as volts). A field that does not fit marks the document as
+ * overflowed and it is not published.
+ *
+ * The publish buffer is held from telemetry_begin() to telemetry_publish(),
+ * the fields should be ready before starting the document.
+ *
+ * @code{.c}
+ * telemetry_t doc;
+ * if(telemetry_begin(&doc))
+ * {
+ *     telemetry_add_int(&doc, "heating", heat);
+ *     telemetry_add_int(&doc, "timer", timer);
+ *     telemetry_publish(&doc, "esp/bed heater/telemetry", 1, 0);
+ * }
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_TELEMETRY_H_
+#define COMPONENTS_IOT_CORE_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char   *buffer;
+    int     size;
+    int     len;
+    bool    overflow;
+} telemetry_t;
+
+/**
+ * @brief take the publish buffer and open the JSON object
+ * @return false if the client is not connected, nothing to publish then
+ */
+bool telemetry_begin(telemetry_t *doc);
+
+/**
+ * @param [in] key static string, written as is without escaping
+ */
+void telemetry_add_int(telemetry_t *doc, const char *key, int32_t value);
+
+void telemetry_add_uint(telemetry_t *doc, const char *key, uint32_t value);
+
+/**
+ * @brief add value / 10^decimals, e.g. (3712, 3) is written 3.712
+ */
+void telemetry_add_fixed(telemetry_t *doc, const char *key, int32_t value, int decimals);
+
+void telemetry_add_bool(telemetry_t *doc, const char *key, bool value);
+
+/**
+ * @param [in] value escaped, NULL is written as null
+ */
+void telemetry_add_string(telemetry_t *doc, const char *key, const char *value);
+
+/**
+ * @brief close the object, publish it and give the publish buffer back
+ * @return the msg_id, -1 if the document overflowed
+ */
+int telemetry_publish(telemetry_t *doc, const char *topic, int qos, int retain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_TELEMETRY_H_ */
@@ -0,0 +1,184 @@
+/*
+ * topic_router.c
+ *
+ * see topic_router.h
+ */
+
+#include <string.h>
+#include "esp_log.h"
+
+#include "topic_router.h"
+
+static const char *TAG = "topic_router";
+
+//FNV-1a, computed while scanning for the level separator
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME  = 16777619u;
+
+static int16_t new_node(topic_router_t *router, const char *level, int len, uint32_t hash)
+{
+    if(router->nb_nodes >= TOPIC_ROUTER_MAX_NODES)
+    {
+        return -1;
+    }
+    int16_t index = router->nb_nodes++;
+    topic_node_t *node = &router->nodes[index];
+    node->level     = level;
+    node->hash      = hash;
+    node->len       = len;
+    node->child     = -1;
+    node->sibling   = -1;
+    node->plus      = -1;
+    node->multi     = -1;
+    node->handler   = NULL;
+    return index;
+}
+
+//scans one level, returns its end (the '/' or end) and its hash
+static const char *scan_level(const char *level, const char *end, uint32_t *hash)
+{
+    uint32_t h = FNV_OFFSET;
+    const char *c = level;
+    while((c < end) && (*c != '/'))
+    {
+        h = (h ^ (uint8_t)(*c)) * FNV_PRIME;
+        c++;
+    }
+    *hash = h;
+    return c;
+}
+
+static int16_t find_child(const topic_router_t *router, const topic_node_t *node,
+                          const char *level, int len, uint32_t hash)
+{
+    for(int16_t c = node->child; c >= 0; c = router->nodes[c].sibling)
+    {
+        const topic_node_t *child = &router->nodes[c];
+        if((child->hash == hash) && (child->len == len) && (memcmp(child->level, level, len) == 0))
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+
+void topic_router_init(topic_router_t *router)
+{
+    router->nb_nodes = 0;
+    new_node(router, "", 0, FNV_OFFSET);
+}
+
+bool topic_router_add(topic_router_t *router, const char *filter, topic_handler_t handler)
+{
+    const char *end = filter + strlen(filter);
+    const char *level = filter;
+    int16_t index = 0;
+    for(;;)
+    {
+        uint32_t hash;
+        const char *level_end = scan_level(level, end, &hash);
+        int len = level_end - level;
+        bool is_last = (level_end == end);
+        topic_node_t *node = &router->nodes[index];
+        int16_t next;
+        if((len == 1) && (level[0] == '#'))
+        {
+            if(!is_last)
+            {
+                ESP_LOGE(TAG, "'#' must be the last level in '%s'", filter);
+                return false;
+            }
+            if(node->multi < 0)
+            {
+                node->multi = new_node(router, level, len, hash);
+            }
+            next = node->multi;
+        }
+        else if((len == 1) && (level[0] == '+'))
+        {
+            if(node->plus < 0)
+            {
+                node->plus = new_node(router, level, len, hash);
+            }
+            next = node->plus;
+        }
+        else
+        {
+            next = find_child(router, node, level, len, hash);
+            if(next < 0)
+            {
+                next = new_node(router, level, len, hash);
+                if(next >= 0)
+                {
+                    router->nodes[next].sibling = node->child;
+                    node->child = next;
+                }
+            }
+        }
+        if(next < 0)
+        {
+            ESP_LOGE(TAG, "no more nodes for '%s', increase TOPIC_ROUTER_MAX_NODES", filter);
+            return false;
+        }
+        index = next;
+        if(is_last)
+        {
+            break;
+        }
+        level = level_end + 1;
+    }
+    router->nodes[index].handler = handler;
+    return true;
+}
+
+//level is NULL once all the topic levels are consumed
+static topic_handler_t route(const topic_router_t *router, int16_t index, const char *level, const char *end)
+{
+    const topic_node_t *node = &router->nodes[index];
+    if(level == NULL)
+    {
+        if(node->handler)
+        {
+            return node->handler;
+        }
+        //"a/#" also matches "a"
+        return (node->multi >= 0) ? router->nodes[node->multi].handler : NULL;
+    }
+
+    uint32_t hash;
+    const char *level_end = scan_level(level, end, &hash);
+    const char *next_level = (level_end < end) ? (level_end + 1) : NULL;
+    topic_handler_t handler = NULL;
+
+    int16_t child = find_child(router, node, level, level_end - level, hash);
+    if(child >= 0)
+    {
+        handler = route(router, child, next_level, end);
+    }
+    if((handler == NULL) && (node->plus >= 0))
+    {
+        handler = route(router, node->plus, next_level, end);
+    }
+    if((handler == NULL) && (node->multi >= 0))
+    {
+        handler = router->nodes[node->multi].handler;
+    }
+    return handler;
+}
+
+topic_handler_t topic_router_find(const topic_router_t *router, const char *topic, int topic_len)
+{
+    return route(router, 0, topic, topic + topic_len);
+}
+
+bool topic_router_dispatch(const topic_router_t *router, const char *topic, int topic_len,
+                           char *payload, int len)
+{
+    topic_handler_t handler = topic_router_find(router, topic, topic_len);
+    if(handler == NULL)
+    {
+        return false;
+    }
+    handler(payload, len);
+    return true;
+}
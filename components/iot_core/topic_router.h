@@ -0,0 +1,85 @@
+/*
+ * topic_router.h
+ *
+ * MQTT topic dispatch shared by the firmware apps.
+ *
+ * Topic filters are registered once at startup and stored as a trie of topic
+ * levels, each level keyed by its hash so that a lookup only walks the levels
+ * of the received topic, whatever the number of registered handlers.
+ * Matching is exact, the MQTT wildcards are supported :
+ *  - '+' matches exactly one level        "esp/+/status"
+ *  - '#' matches any remaining levels     "esp/curvy/#" (also matches "esp/curvy")
+ * When several filters match, the most specific one wins : at each level the
+ * exact match is tried first, then '+', then '#'.
+ *
+ * @code{.c}
+ * static topic_router_t router;
+ * topic_router_init(&router);
+ * topic_router_add(&router, "esp/curvy/pixels/all", &json_led_set_all);
+ * ...
+ * topic_router_dispatch(&router, event->topic, event->topic_len, event->data, event->data_len);
+ * @endcode
+ */
+
+#ifndef COMPONENTS_IOT_CORE_TOPIC_ROUTER_H_
+#define COMPONENTS_IOT_CORE_TOPIC_ROUTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//one node per distinct topic level, the root included
+#ifndef TOPIC_ROUTER_MAX_NODES
+#define TOPIC_ROUTER_MAX_NODES 32
+#endif
+
+//the payload is the receive buffer of the client, not null terminated, the
+//handler may modify it in place (e.g. to decode JSON strings where they are)
+typedef void (*topic_handler_t)(char *payload, int len);
+
+typedef struct {
+    const char     *level;      //points into the registered filter, not null terminated
+    uint32_t        hash;
+    uint16_t        len;
+    int16_t         child;      //first exact child, -1 if none
+    int16_t         sibling;    //next exact sibling, -1 if none
+    int16_t         plus;       //'+' child, -1 if none
+    int16_t         multi;      //'#' child, -1 if none
+    topic_handler_t handler;
+} topic_node_t;
+
+typedef struct {
+    topic_node_t nodes[TOPIC_ROUTER_MAX_NODES];
+    int16_t      nb_nodes;
+} topic_router_t;
+
+void topic_router_init(topic_router_t *router);
+
+/**
+ * @brief register a handler for a topic filter
+ * @param [in] filter the topic filter, not copied so it must outlive the router
+ * @return false if the filter is malformed or the nodes pool is exhausted
+ */
+bool topic_router_add(topic_router_t *router, const char *filter, topic_handler_t handler);
+
+/**
+ * @brief find the handler matching the topic
+ * @return the handler or NULL if no filter matches
+ */
+topic_handler_t topic_router_find(const topic_router_t *router, const char *topic, int topic_len);
+
+/**
+ * @brief call the handler matching the topic with the payload
+ * @return true if a handler was called
+ */
+bool topic_router_dispatch(const topic_router_t *router, const char *topic, int topic_len,
+                           char *payload, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPONENTS_IOT_CORE_TOPIC_ROUTER_H_ */
@@ -5,11 +5,13 @@
 #pragma once
 
 #include "version.hpp"
+#include "ArenaJsonBuffer.hpp"
 #include "DynamicJsonBuffer.hpp"
 #include "JsonArray.hpp"
 #include "JsonObject.hpp"
 #include "StaticJsonBuffer.hpp"
 #include "Deserialization/JsonParserImpl.hpp"
+#include "Deserialization/MsgPackParserImpl.hpp"
 #include "JsonArrayImpl.hpp"
 #include "JsonBufferImpl.hpp"
 #include "JsonObjectImpl.hpp"
@@ -0,0 +1,171 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "DynamicJsonBuffer.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace ArduinoJson {
+
+// A pool of blocks for the DynamicJsonBuffer that survives the buffers.
+// Blocks released by a buffer go to a free list and are handed again to the
+// next buffer, so once the arena has grown to the biggest message no more
+// heap allocation happens. New blocks are taken from the optional static
+// pool first, then from the heap, as long as the total stays under the cap.
+//
+// Not thread safe, use one arena per task.
+//
+// static ArduinoJson::JsonArena arena(8192);
+// ArduinoJson::ArenaJsonBuffer jsonBuffer(&arena);
+class JsonArena {
+  struct Block {
+    Block* next;
+    size_t capacity;
+    bool fromHeap;
+  };
+
+ public:
+  enum { Alignment = 8 };
+
+  JsonArena(size_t cap, void* pool = NULL, size_t poolSize = 0)
+      : _free(NULL),
+        _pool(static_cast<uint8_t*>(pool)),
+        _poolSize(pool ? poolSize : 0),
+        _poolUsed(0),
+        _cap(cap),
+        _reserved(0),
+        _inUse(0),
+        _highWaterMark(0),
+        _failures(0) {}
+
+  ~JsonArena() {
+    // blocks still held by a buffer are leaked rather than freed under it
+    Block* block = _free;
+    while (block) {
+      Block* next = block->next;
+      if (block->fromHeap) free(block);
+      block = next;
+    }
+  }
+
+  void* allocate(size_t size) {
+    Block* block = takeFree(size);
+    if (!block) block = newBlock(size);
+    if (!block) {
+      _failures++;
+      return NULL;
+    }
+    _inUse += block->capacity;
+    if (_inUse > _highWaterMark) _highWaterMark = _inUse;
+    return reinterpret_cast<uint8_t*>(block) + headerSize();
+  }
+
+  void deallocate(void* pointer) {
+    if (!pointer) return;
+    Block* block = reinterpret_cast<Block*>(static_cast<uint8_t*>(pointer) -
+                                            headerSize());
+    _inUse -= block->capacity;
+    block->next = _free;
+    _free = block;
+  }
+
+  // bytes held by the arena, in use or free
+  size_t reserved() const {
+    return _reserved;
+  }
+
+  // bytes currently handed to the buffers
+  size_t inUse() const {
+    return _inUse;
+  }
+
+  // the most bytes ever handed to the buffers at the same time
+  size_t highWaterMark() const {
+    return _highWaterMark;
+  }
+
+  // allocations refused because of the cap or of the heap
+  size_t failures() const {
+    return _failures;
+  }
+
+ private:
+  static size_t alignSize(size_t size) {
+    return (size + Alignment - 1) & ~size_t(Alignment - 1);
+  }
+
+  static size_t headerSize() {
+    return alignSize(sizeof(Block));
+  }
+
+  // best fit, so that a small request does not take the biggest block
+  Block* takeFree(size_t size) {
+    Block** best = NULL;
+    for (Block** it = &_free; *it; it = &(*it)->next) {
+      if ((*it)->capacity < size) continue;
+      if (!best || (*it)->capacity < (*best)->capacity) best = it;
+    }
+    if (!best) return NULL;
+    Block* block = *best;
+    *best = block->next;
+    return block;
+  }
+
+  Block* newBlock(size_t size) {
+    size_t capacity = alignSize(size);
+    size_t bytes = headerSize() + capacity;
+    if (_reserved + bytes > _cap) return NULL;
+    Block* block;
+    uintptr_t poolBase = reinterpret_cast<uintptr_t>(_pool);
+    size_t poolStart = alignSize(poolBase + _poolUsed) - poolBase;
+    if (_pool && poolStart + bytes <= _poolSize) {
+      block = reinterpret_cast<Block*>(_pool + poolStart);
+      block->fromHeap = false;
+      _poolUsed = poolStart + bytes;
+    } else {
+      block = static_cast<Block*>(malloc(bytes));
+      if (!block) return NULL;
+      block->fromHeap = true;
+    }
+    block->capacity = capacity;
+    _reserved += bytes;
+    return block;
+  }
+
+  Block* _free;
+  uint8_t* _pool;
+  size_t _poolSize;
+  size_t _poolUsed;
+  size_t _cap;
+  size_t _reserved;
+  size_t _inUse;
+  size_t _highWaterMark;
+  size_t _failures;
+};
+
+namespace Internals {
+class ArenaAllocator {
+ public:
+  ArenaAllocator(JsonArena* arena) : _arena(arena) {}
+
+  void* allocate(size_t size) {
+    return _arena->allocate(size);
+  }
+  void deallocate(void* pointer) {
+    _arena->deallocate(pointer);
+  }
+
+ private:
+  JsonArena* _arena;
+};
+}  // namespace Internals
+
+// A DynamicJsonBuffer whose blocks come from a JsonArena, the blocks go back
+// to the arena on clear() and on destruction.
+typedef Internals::DynamicJsonBufferBase<Internals::ArenaAllocator>
+    ArenaJsonBuffer;
+}  // namespace ArduinoJson
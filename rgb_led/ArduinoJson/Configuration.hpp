@@ -135,6 +135,24 @@
 #define ARDUINOJSON_ENABLE_DEPRECATED 1
 #endif
 
+// Skip the C and C++ comments between the tokens, disable it when the input
+// is always strict JSON
+#ifndef ARDUINOJSON_ENABLE_COMMENTS
+#define ARDUINOJSON_ENABLE_COMMENTS 1
+#endif
+
+// Decode the numbers while parsing, instead of storing their text and
+// parsing it again on every conversion
+#ifndef ARDUINOJSON_DECODE_NUMBERS
+#define ARDUINOJSON_DECODE_NUMBERS 1
+#endif
+
+// Objects with at least this many keys get a hash index when parsed, so that
+// looking up a key does not scan all the keys (0 to disable)
+#ifndef ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+#define ARDUINOJSON_OBJECT_INDEX_THRESHOLD 8
+#endif
+
 // Control the exponentiation threshold for big numbers
 // CAUTION: cannot be more that 1e9 !!!!
 #ifndef ARDUINOJSON_POSITIVE_EXPONENTIATION_THRESHOLD
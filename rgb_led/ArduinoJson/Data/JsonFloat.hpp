@@ -9,6 +9,12 @@
 namespace ArduinoJson {
 namespace Internals {
 
+// JsonWriter prints the shortest digits that read back to the same JsonFloat.
+// With a double JsonFloat, the default on the ESP32 and the hosts, a float
+// value is widened when it is stored and prints with the digits of the double,
+// e.g. 0.1f gives 0.10000000149011612: the variant does not remember that it
+// was a float, and the float digits "0.1" would read back as another double.
+// Set ARDUINOJSON_USE_DOUBLE to 0 for the shortest float digits.
 #if ARDUINOJSON_USE_DOUBLE
 typedef double JsonFloat;
 #else
@@ -27,7 +27,8 @@ class List {
   // When buffer is NULL, the List is not able to grow and success() returns
   // false. This is used to identify bad memory allocations and parsing
   // failures.
-  explicit List(JsonBuffer *buffer) : _buffer(buffer), _firstNode(NULL) {}
+  explicit List(JsonBuffer *buffer)
+      : _buffer(buffer), _firstNode(NULL), _lastNode(NULL) {}
 
   // Returns true if the object is valid
   // Would return false in the following situation:
@@ -45,20 +46,43 @@ class List {
     return nodeCount;
   }
 
+  // The last node is kept so that building a list of n elements is O(n)
   iterator add() {
     node_type *newNode = new (_buffer) node_type();
 
     if (_firstNode) {
-      node_type *lastNode = _firstNode;
-      while (lastNode->next) lastNode = lastNode->next;
-      lastNode->next = newNode;
+      _lastNode->next = newNode;
     } else {
       _firstNode = newNode;
     }
+    _lastNode = newNode;
 
     return iterator(newNode);
   }
 
+  // Appends count nodes from a single allocation, for the readers that know
+  // the length before the values. Returns an iterator on the first new node,
+  // end() when count is 0 or the allocation failed.
+  iterator add(size_t count) {
+    if (count == 0 || !_buffer) return end();
+    node_type *nodes =
+        static_cast<node_type *>(_buffer->alloc(count * sizeof(node_type)));
+    if (!nodes) return end();
+    for (size_t i = 0; i < count; i++) {
+      nodes[i].next = i + 1 < count ? &nodes[i + 1] : NULL;
+      nodes[i].content = T();
+    }
+
+    if (_firstNode) {
+      _lastNode->next = nodes;
+    } else {
+      _firstNode = nodes;
+    }
+    _lastNode = &nodes[count - 1];
+
+    return iterator(nodes);
+  }
+
   iterator begin() {
     return iterator(_firstNode);
   }
@@ -76,19 +100,29 @@ class List {
   void remove(iterator it) {
     node_type *nodeToRemove = it._node;
     if (!nodeToRemove) return;
+    node_type *previous = NULL;
     if (nodeToRemove == _firstNode) {
       _firstNode = nodeToRemove->next;
     } else {
       for (node_type *node = _firstNode; node; node = node->next)
-        if (node->next == nodeToRemove) node->next = nodeToRemove->next;
+        if (node->next == nodeToRemove) {
+          node->next = nodeToRemove->next;
+          previous = node;
+        }
     }
+    if (nodeToRemove == _lastNode) _lastNode = previous;
   }
 
  protected:
+  node_type *firstNode() const {
+    return _firstNode;
+  }
+
   JsonBuffer *_buffer;
 
  private:
   node_type *_firstNode;
+  node_type *_lastNode;
 };
 }
 }
@@ -4,12 +4,23 @@
 
 #pragma once
 
+#include "../Configuration.hpp"
+
 namespace ArduinoJson {
 namespace Internals {
 template <typename TInput>
 void skipSpacesAndComments(TInput& input) {
   for (;;) {
-    switch (input.current()) {
+    // every token starts above the space, the compact payloads never go
+    // further than this compare
+    char c = input.current();
+#if ARDUINOJSON_ENABLE_COMMENTS
+    if (static_cast<unsigned char>(c) > ' ' && c != '/') return;
+#else
+    if (static_cast<unsigned char>(c) > ' ') return;
+#endif
+
+    switch (c) {
       // spaces
       case ' ':
       case '\t':
@@ -18,6 +29,7 @@ void skipSpacesAndComments(TInput& input) {
         input.move();
         continue;
 
+#if ARDUINOJSON_ENABLE_COMMENTS
       // comments
       case '/':
         switch (input.next()) {
@@ -51,6 +63,7 @@ void skipSpacesAndComments(TInput& input) {
             return;
         }
         break;
+#endif
 
       default:
         return;
@@ -48,6 +48,18 @@ class JsonParser {
   inline bool parseArrayTo(JsonVariant *destination);
   inline bool parseObjectTo(JsonVariant *destination);
   inline bool parseStringTo(JsonVariant *destination);
+#if ARDUINOJSON_DECODE_NUMBERS
+  inline bool parseNumberTo(JsonVariant *destination);
+
+  // a number starts with a digit, or with a sign or a dot followed by one
+  // "-Infinity" and "NaN" are left to the unquoted string path
+  static inline bool isNumberStart(char c, char next) {
+    if (isBetween(c, '0', '9')) return true;
+    if (c == '-' || c == '+' || c == '.')
+      return isBetween(next, '0', '9') || (c != '.' && next == '.');
+    return false;
+  }
+#endif
 
   static inline bool isBetween(char c, char min, char max) {
     return min <= c && c <= max;
@@ -92,6 +104,32 @@ struct JsonParserBuilder<TJsonBuffer, TChar *,
   }
 };
 
+// a sized mutable buffer is decoded in place as well, the strings are
+// unescaped and terminated where they are, the variants point into it
+template <typename TJsonBuffer, typename TChar>
+struct SizedParserBuilder {
+  typedef typename StringTraits<SizedString<TChar> >::Reader TReader;
+  typedef SizedStringWriter<TChar> TWriter;
+  typedef JsonParser<TReader, TWriter> TParser;
+
+  static TParser makeParser(TJsonBuffer *buffer,
+                            const SizedString<TChar> &json,
+                            uint8_t nestingLimit) {
+    return TParser(buffer, TReader(json), TWriter(json.ptr(), json.size()),
+                   nestingLimit);
+  }
+};
+
+template <typename TJsonBuffer, typename TChar>
+struct JsonParserBuilder<TJsonBuffer, SizedString<TChar>,
+                         typename EnableIf<!IsConst<TChar>::value>::type>
+    : SizedParserBuilder<TJsonBuffer, TChar> {};
+
+template <typename TJsonBuffer, typename TChar>
+struct JsonParserBuilder<TJsonBuffer, const SizedString<TChar>,
+                         typename EnableIf<!IsConst<TChar>::value>::type>
+    : SizedParserBuilder<TJsonBuffer, TChar> {};
+
 template <typename TJsonBuffer, typename TString>
 inline typename JsonParserBuilder<TJsonBuffer, TString>::TParser makeParser(
     TJsonBuffer *buffer, TString &json, uint8_t nestingLimit) {
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include "../Data/JsonFloat.hpp"
+#include "../Data/JsonInteger.hpp"
+#include "../TypeTraits/FloatTraits.hpp"
 #include "Comments.hpp"
 #include "JsonParser.hpp"
 
@@ -95,7 +98,7 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObject() {
   if (eat('}')) goto SUCCESS_EMPTY_OBJECT;
 
   // Read each key value pair
-  for (;;) {
+  for (size_t count = 1;; count++) {
     // 1 - Parse key
     const char *key = parseString();
     if (!key) goto ERROR_INVALID_KEY;
@@ -107,7 +110,12 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObject() {
     if (!object.set(key, value)) goto ERROR_NO_MEMORY;
 
     // 3 - More keys/values?
-    if (eat('}')) goto SUCCESS_NON_EMPTY_OBJECT;
+    if (eat('}')) {
+#if ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+      if (count >= ARDUINOJSON_OBJECT_INDEX_THRESHOLD) object.buildIndex();
+#endif
+      goto SUCCESS_NON_EMPTY_OBJECT;
+    }
     if (!eat(',')) goto ERROR_MISSING_COMMA;
   }
 
@@ -177,6 +185,10 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseString() {
 template <typename TReader, typename TWriter>
 inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStringTo(
     JsonVariant *destination) {
+#if ARDUINOJSON_DECODE_NUMBERS
+  if (isNumberStart(_reader.current(), _reader.next()))
+    return parseNumberTo(destination);
+#endif
   bool hasQuotes = isQuote(_reader.current());
   const char *value = parseString();
   if (value == NULL) return false;
@@ -187,3 +199,127 @@ inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStringTo(
   }
   return true;
 }
+
+#if ARDUINOJSON_DECODE_NUMBERS
+// Decodes the number straight from the reader, nothing is written to the
+// buffer. Integers are kept exact as long as they fit in a JsonInteger or a
+// JsonUInt, anything else becomes a JsonFloat.
+template <typename TReader, typename TWriter>
+inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseNumberTo(
+    JsonVariant *destination) {
+  typedef FloatTraits<JsonFloat> traits;
+  typedef traits::mantissa_type mantissa_t;
+
+  bool negative = false;
+  char c = _reader.current();
+  if (c == '-' || c == '+') {
+    negative = c == '-';
+    _reader.move();
+    c = _reader.current();
+  }
+
+  JsonUInt integer = 0;
+  bool isInteger = true;
+  mantissa_t mantissa = 0;
+  int exponent = 0;
+
+  // fast path for the short unsigned integers, the bulk of our payloads:
+  // 32-bit arithmetic and no overflow check. The digits count keeps the value
+  // exact in the mantissa of a float as well, the loop below then goes on
+  // from the same state.
+  if (!negative) {
+    const uint8_t maxDigits = sizeof(JsonFloat) >= 8 ? 9 : 6;
+    uint32_t value = 0;
+    for (uint8_t n = 0; n < maxDigits && isBetween(c, '0', '9'); n++) {
+      value = value * 10 + uint32_t(c - '0');
+      _reader.move();
+      c = _reader.current();
+    }
+    if (!canBeInNonQuotedString(c)) {
+      *destination = value;
+      return true;
+    }
+    integer = value;
+    mantissa = mantissa_t(value);
+  }
+
+  const JsonUInt maxInteger = JsonUInt(-1);
+  while (isBetween(c, '0', '9')) {
+    uint8_t digit = uint8_t(c - '0');
+    if (integer > maxInteger / 10 ||
+        (integer == maxInteger / 10 && digit > maxInteger % 10))
+      isInteger = false;
+    integer = integer * 10 + digit;
+    if (mantissa < traits::mantissa_max / 10)
+      mantissa = mantissa * 10 + digit;
+    else
+      exponent++;
+    _reader.move();
+    c = _reader.current();
+  }
+
+  if (c == '.') {
+    isInteger = false;
+    _reader.move();
+    c = _reader.current();
+    while (isBetween(c, '0', '9')) {
+      if (mantissa < traits::mantissa_max / 10) {
+        mantissa = mantissa * 10 + (c - '0');
+        exponent--;
+      }
+      _reader.move();
+      c = _reader.current();
+    }
+  }
+
+  if (c == 'e' || c == 'E') {
+    isInteger = false;
+    _reader.move();
+    c = _reader.current();
+    bool negativeExponent = false;
+    if (c == '-' || c == '+') {
+      negativeExponent = c == '-';
+      _reader.move();
+      c = _reader.current();
+    }
+    int explicitExponent = 0;
+    while (isBetween(c, '0', '9')) {
+      // saturate, the result is 0 or infinity anyway
+      if (explicitExponent < 10 * traits::exponent_max)
+        explicitExponent = explicitExponent * 10 + (c - '0');
+      _reader.move();
+      c = _reader.current();
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  // like the conversions of the unparsed text did, trailing garbage is ignored
+  while (canBeInNonQuotedString(c)) {
+    _reader.move();
+    c = _reader.current();
+  }
+
+  if (isInteger) {
+    if (!negative) {
+      *destination = integer;
+      return true;
+    }
+    if (integer <= JsonUInt(~JsonUInt(0) >> 1)) {
+      *destination = -JsonInteger(integer);
+      return true;
+    }
+  }
+
+  JsonFloat value;
+  if (mantissa == 0)
+    value = 0;
+  else if (exponent > traits::exponent_max)
+    value = traits::inf();
+  else if (exponent < -traits::exponent_max - 16)  // below the mantissa digits
+    value = 0;
+  else
+    value = traits::make_float(static_cast<JsonFloat>(mantissa), exponent);
+  *destination = negative ? -value : value;
+  return true;
+}
+#endif
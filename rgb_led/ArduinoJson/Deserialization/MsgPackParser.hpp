@@ -0,0 +1,71 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Data/JsonFloat.hpp"
+#include "../Data/JsonInteger.hpp"
+#include "../JsonBuffer.hpp"
+#include "../JsonVariant.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// Parse a MessagePack document to create JsonArrays and JsonObjects, the same
+// model as JsonParser so that the result is used the same way.
+//
+// The numbers are stored already decoded and the strings are copied in the
+// JsonBuffer, the input is only read. Maps must have string keys, and the
+// bin and ext types are refused since they have no JSON equivalent.
+//
+// This internal class is not indended to be used directly.
+// Instead, use JsonBuffer.parseMsgPackArray() or .parseMsgPackObject()
+class MsgPackParser {
+ public:
+  MsgPackParser(JsonBuffer *buffer, const void *data, size_t size,
+                uint8_t nestingLimit)
+      : _buffer(buffer),
+        _ptr(static_cast<const uint8_t *>(data)),
+        _end(static_cast<const uint8_t *>(data) + size),
+        _nestingLimit(nestingLimit) {}
+
+  inline JsonArray &parseArray();
+  inline JsonObject &parseObject();
+
+  JsonVariant parseVariant() {
+    JsonVariant result;
+    parseAnythingTo(&result);
+    return result;
+  }
+
+ private:
+  MsgPackParser &operator=(const MsgPackParser &);  // non-copiable
+
+  inline bool parseAnythingTo(JsonVariant *destination);
+  inline bool parseArrayTo(JsonVariant *destination, size_t count);
+  inline bool parseObjectTo(JsonVariant *destination, size_t count);
+  inline JsonArray &parseArrayItems(size_t count);
+  inline JsonObject &parseObjectItems(size_t count);
+  inline const char *parseString();
+  inline const char *readString(size_t length);
+
+  // the length that follows the codes of array 16/32 or map 16/32
+  inline bool readLength(uint8_t code, size_t &length);
+
+  // a big endian unsigned integer of the given number of bytes
+  template <typename T>
+  bool readUnsigned(uint8_t bytes, T &value) {
+    if (size_t(_end - _ptr) < bytes) return false;
+    value = 0;
+    for (uint8_t i = 0; i < bytes; i++) value = T((value << 8) | *_ptr++);
+    return true;
+  }
+
+  JsonBuffer *_buffer;
+  const uint8_t *_ptr;
+  const uint8_t *_end;
+  uint8_t _nestingLimit;
+};
+}  // namespace Internals
+}  // namespace ArduinoJson
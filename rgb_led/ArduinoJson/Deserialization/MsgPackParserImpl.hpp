@@ -0,0 +1,284 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include <string.h>  // for memcpy
+
+#include "MsgPackParser.hpp"
+
+inline ArduinoJson::JsonArray &
+ArduinoJson::Internals::MsgPackParser::parseArray() {
+  if (_ptr == _end) return JsonArray::invalid();
+  uint8_t code = *_ptr++;
+  size_t count;
+  if ((code & 0xF0) == 0x90)
+    count = code & 0x0F;
+  else if (!readLength(code, count) || (code != 0xDC && code != 0xDD))
+    return JsonArray::invalid();
+  return parseArrayItems(count);
+}
+
+inline ArduinoJson::JsonObject &
+ArduinoJson::Internals::MsgPackParser::parseObject() {
+  if (_ptr == _end) return JsonObject::invalid();
+  uint8_t code = *_ptr++;
+  size_t count;
+  if ((code & 0xF0) == 0x80)
+    count = code & 0x0F;
+  else if (!readLength(code, count) || (code != 0xDE && code != 0xDF))
+    return JsonObject::invalid();
+  return parseObjectItems(count);
+}
+
+inline bool ArduinoJson::Internals::MsgPackParser::readLength(uint8_t code,
+                                                              size_t &length) {
+  switch (code) {
+    case 0xDC:
+    case 0xDE: {
+      uint16_t value;
+      if (!readUnsigned(2, value)) return false;
+      length = value;
+      return true;
+    }
+    case 0xDD:
+    case 0xDF: {
+      uint32_t value;
+      if (!readUnsigned(4, value)) return false;
+      length = value;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+inline ArduinoJson::JsonArray &
+ArduinoJson::Internals::MsgPackParser::parseArrayItems(size_t count) {
+  if (_nestingLimit == 0) return JsonArray::invalid();
+  // every item takes at least one byte, a bigger count is a corrupted length
+  if (count > size_t(_end - _ptr)) return JsonArray::invalid();
+  _nestingLimit--;
+
+  // the nodes of the items come from one allocation and the items are read in
+  // place, instead of an allocation and a copy per item
+  JsonArray &array = _buffer->createArray();
+  if (count > 0) {
+    JsonArray::iterator it = array.Internals::List<JsonVariant>::add(count);
+    if (it == array.end()) return JsonArray::invalid();
+    for (; it != array.end(); ++it)
+      if (!parseAnythingTo(&*it)) return JsonArray::invalid();
+  }
+
+  _nestingLimit++;
+  return array;
+}
+
+inline ArduinoJson::JsonObject &
+ArduinoJson::Internals::MsgPackParser::parseObjectItems(size_t count) {
+  if (_nestingLimit == 0) return JsonObject::invalid();
+  if (count > size_t(_end - _ptr) / 2) return JsonObject::invalid();
+  _nestingLimit--;
+
+  JsonObject &object = _buffer->createObject();
+  for (size_t i = 0; i < count; i++) {
+    const char *key = parseString();
+    if (!key) return JsonObject::invalid();
+    JsonVariant value;
+    if (!parseAnythingTo(&value)) return JsonObject::invalid();
+    if (!object.set(key, value)) return JsonObject::invalid();
+  }
+#if ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+  if (count >= ARDUINOJSON_OBJECT_INDEX_THRESHOLD) object.buildIndex();
+#endif
+
+  _nestingLimit++;
+  return object;
+}
+
+inline bool ArduinoJson::Internals::MsgPackParser::parseArrayTo(
+    JsonVariant *destination, size_t count) {
+  JsonArray &array = parseArrayItems(count);
+  if (!array.success()) return false;
+
+  *destination = array;
+  return true;
+}
+
+inline bool ArduinoJson::Internals::MsgPackParser::parseObjectTo(
+    JsonVariant *destination, size_t count) {
+  JsonObject &object = parseObjectItems(count);
+  if (!object.success()) return false;
+
+  *destination = object;
+  return true;
+}
+
+// a copy in the JsonBuffer, null terminated
+inline const char *ArduinoJson::Internals::MsgPackParser::readString(
+    size_t length) {
+  if (length > size_t(_end - _ptr)) return NULL;
+  char *str = static_cast<char *>(_buffer->alloc(length + 1));
+  if (!str) return NULL;
+  memcpy(str, _ptr, length);
+  str[length] = '\0';
+  _ptr += length;
+  return str;
+}
+
+inline const char *ArduinoJson::Internals::MsgPackParser::parseString() {
+  if (_ptr == _end) return NULL;
+  uint8_t code = *_ptr++;
+  if ((code & 0xE0) == 0xA0) return readString(code & 0x1F);
+
+  uint32_t length;
+  switch (code) {
+    case 0xD9:
+      if (!readUnsigned(1, length)) return NULL;
+      break;
+    case 0xDA:
+      if (!readUnsigned(2, length)) return NULL;
+      break;
+    case 0xDB:
+      if (!readUnsigned(4, length)) return NULL;
+      break;
+    default:
+      return NULL;
+  }
+  return readString(length);
+}
+
+inline bool ArduinoJson::Internals::MsgPackParser::parseAnythingTo(
+    JsonVariant *destination) {
+  if (_ptr == _end) return false;
+  uint8_t code = *_ptr;
+
+  // the single byte forms first, they are most of the pixel lists
+  if (code <= 0x7F) {
+    _ptr++;
+    *destination = code;
+    return true;
+  }
+  if (code >= 0xE0) {
+    _ptr++;
+    *destination = int8_t(code);
+    return true;
+  }
+  if ((code & 0xE0) == 0xA0) {
+    const char *value = parseString();
+    if (!value) return false;
+    *destination = value;
+    return true;
+  }
+  if ((code & 0xF0) == 0x90) {
+    _ptr++;
+    return parseArrayTo(destination, code & 0x0F);
+  }
+  if ((code & 0xF0) == 0x80) {
+    _ptr++;
+    return parseObjectTo(destination, code & 0x0F);
+  }
+
+  _ptr++;
+  switch (code) {
+    case 0xC0:  // like an unquoted null in JSON
+      *destination = RawJson("null");
+      return true;
+
+    case 0xC2:
+      *destination = false;
+      return true;
+
+    case 0xC3:
+      *destination = true;
+      return true;
+
+    case 0xCA: {
+      uint32_t bits;
+      if (!readUnsigned(4, bits)) return false;
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      *destination = value;
+      return true;
+    }
+
+    case 0xCB: {
+      uint64_t bits;
+      if (!readUnsigned(8, bits)) return false;
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      *destination = JsonFloat(value);
+      return true;
+    }
+
+    case 0xCC:
+    case 0xCD:
+    case 0xCE: {
+      uint32_t value;
+      if (!readUnsigned(uint8_t(1 << (code - 0xCC)), value)) return false;
+      *destination = value;
+      return true;
+    }
+
+    case 0xCF: {
+      uint64_t value;
+      if (!readUnsigned(8, value)) return false;
+      if (uint64_t(JsonUInt(value)) == value)
+        *destination = JsonUInt(value);
+      else
+        *destination = JsonFloat(value);
+      return true;
+    }
+
+    case 0xD0:
+    case 0xD1:
+    case 0xD2: {
+      uint8_t bytes = uint8_t(1 << (code - 0xD0));
+      uint32_t bits;
+      if (!readUnsigned(bytes, bits)) return false;
+      // sign extension from the top bit of the encoded width
+      uint32_t sign = uint32_t(1) << (8 * bytes - 1);
+      *destination = int32_t((bits ^ sign) - sign);
+      return true;
+    }
+
+    case 0xD3: {
+      uint64_t bits;
+      if (!readUnsigned(8, bits)) return false;
+      int64_t value = int64_t(bits);
+      if (int64_t(JsonInteger(value)) == value)
+        *destination = JsonInteger(value);
+      else
+        *destination = JsonFloat(value);
+      return true;
+    }
+
+    case 0xD9:
+    case 0xDA:
+    case 0xDB: {
+      _ptr--;
+      const char *value = parseString();
+      if (!value) return false;
+      *destination = value;
+      return true;
+    }
+
+    case 0xDC:
+    case 0xDD: {
+      size_t count;
+      if (!readLength(code, count)) return false;
+      return parseArrayTo(destination, count);
+    }
+
+    case 0xDE:
+    case 0xDF: {
+      size_t count;
+      if (!readLength(code, count)) return false;
+      return parseObjectTo(destination, count);
+    }
+
+    default:  // bin, ext and the unused code 0xC1
+      return false;
+  }
+}
@@ -37,5 +37,45 @@ class StringWriter {
  private:
   TChar* _ptr;
 };
+
+// Same as StringWriter for a buffer without terminator, see SizedString.
+// The writer never gets ahead of the reader, so only the terminator of a
+// string that runs to the very end of the buffer could go past it, such a
+// string is refused.
+template <typename TChar>
+class SizedStringWriter {
+ public:
+  class String {
+   public:
+    String(TChar** ptr, TChar* end)
+        : _writePtr(ptr), _startPtr(*ptr), _end(end) {}
+
+    void append(char c) {
+      *(*_writePtr)++ = TChar(c);
+    }
+
+    const char* c_str() const {
+      if (*_writePtr == _end) return NULL;
+      *(*_writePtr)++ = 0;
+      return reinterpret_cast<const char*>(_startPtr);
+    }
+
+   private:
+    TChar** _writePtr;
+    TChar* _startPtr;
+    TChar* _end;
+  };
+
+  SizedStringWriter(TChar* buffer, size_t size)
+      : _ptr(buffer), _end(buffer + size) {}
+
+  String startString() {
+    return String(&_ptr, _end);
+  }
+
+ private:
+  TChar* _ptr;
+  TChar* _end;
+};
 }
 }
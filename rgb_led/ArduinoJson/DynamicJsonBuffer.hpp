@@ -49,6 +49,9 @@ class DynamicJsonBufferBase
   DynamicJsonBufferBase(size_t initialSize = 256)
       : _head(NULL), _nextBlockCapacity(initialSize) {}
 
+  DynamicJsonBufferBase(TAllocator allocator, size_t initialSize = 256)
+      : _allocator(allocator), _head(NULL), _nextBlockCapacity(initialSize) {}
+
   ~DynamicJsonBufferBase() {
     clear();
   }
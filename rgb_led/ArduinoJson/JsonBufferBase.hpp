@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Deserialization/JsonParser.hpp"
+#include "Deserialization/MsgPackParser.hpp"
 
 namespace ArduinoJson {
 namespace Internals {
@@ -115,6 +116,28 @@ class JsonBufferBase : public JsonBuffer {
     return Internals::makeParser(that(), json, nestingLimit).parseVariant();
   }
 
+  // Same as parseArray(), parseObject() and parse() for a MessagePack
+  // document of the given size. The input is not modified, the strings are
+  // copied in the JsonBuffer.
+  JsonArray &parseMsgPackArray(
+      const void *data, size_t size,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::MsgPackParser(that(), data, size, nestingLimit)
+        .parseArray();
+  }
+  JsonObject &parseMsgPackObject(
+      const void *data, size_t size,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::MsgPackParser(that(), data, size, nestingLimit)
+        .parseObject();
+  }
+  JsonVariant parseMsgPack(
+      const void *data, size_t size,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::MsgPackParser(that(), data, size, nestingLimit)
+        .parseVariant();
+  }
+
  protected:
   ~JsonBufferBase() {}
 
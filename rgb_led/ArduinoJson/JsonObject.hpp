@@ -47,7 +47,7 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   // You should not use this constructor directly.
   // Instead, use JsonBuffer::createObject() or JsonBuffer.parseObject().
   explicit JsonObject(JsonBuffer* buffer) throw()
-      : Internals::List<JsonPair>(buffer) {}
+      : Internals::List<JsonPair>(buffer), _index(NULL), _indexMask(0) {}
 
   // Gets or sets the value associated with the specified key.
   //
@@ -251,7 +251,40 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   }
   //
   // void remove(iterator)
-  using Internals::List<JsonPair>::remove;
+  void remove(iterator it) {
+    _index = NULL;
+    Internals::List<JsonPair>::remove(it);
+  }
+
+  // Builds a hash index of the keys, the lookups then only compare the keys
+  // that share a slot instead of all of them.
+  // The parser calls it for the objects of ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+  // keys or more. Adding or removing a key drops the index, the object falls
+  // back to the linear search. Renaming a key through an iterator is not
+  // tracked, call buildIndex() again after doing it.
+  // Returns false if the index could not be allocated.
+  bool buildIndex() {
+    _index = NULL;
+    if (!_buffer) return false;
+    size_t count = size();
+    size_t slots = 4;
+    while (slots < 2 * count) slots *= 2;  // at most half full
+    if (slots > 0x10000) return false;
+    node_type** index =
+        static_cast<node_type**>(_buffer->alloc(slots * sizeof(node_type*)));
+    if (!index) return false;
+    memset(index, 0, slots * sizeof(node_type*));
+    uint16_t mask = uint16_t(slots - 1);
+    for (node_type* node = firstNode(); node; node = node->next) {
+      if (!node->content.key) continue;
+      uint16_t slot = uint16_t(hashKey<const char*>(node->content.key) & mask);
+      while (index[slot]) slot = uint16_t((slot + 1) & mask);
+      index[slot] = node;
+    }
+    _index = index;
+    _indexMask = mask;
+    return true;
+  }
 
   // Returns a reference an invalid JsonObject.
   // This object is meant to replace a NULL pointer.
@@ -262,9 +295,30 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   }
 
  private:
+  // FNV-1a of the key characters
+  template <typename TStringRef>
+  static uint32_t hashKey(TStringRef key) {
+    typename Internals::StringTraits<TStringRef>::Reader reader(key);
+    uint32_t hash = 2166136261u;
+    for (char c = reader.current(); c != '\0'; c = reader.current()) {
+      hash = (hash ^ uint8_t(c)) * 16777619u;
+      reader.move();
+    }
+    return hash;
+  }
+
   // Returns the list node that matches the specified key.
   template <typename TStringRef>
   iterator findKey(TStringRef key) {
+    if (_index && !Internals::StringTraits<TStringRef>::is_null(key)) {
+      uint16_t slot = uint16_t(hashKey<TStringRef>(key) & _indexMask);
+      for (node_type* node = _index[slot]; node; node = _index[slot]) {
+        if (Internals::StringTraits<TStringRef>::equals(key, node->content.key))
+          return iterator(node);
+        slot = uint16_t((slot + 1) & _indexMask);
+      }
+      return end();
+    }
     iterator it;
     for (it = begin(); it != end(); ++it) {
       if (Internals::StringTraits<TStringRef>::equals(key, it->key)) break;
@@ -293,6 +347,7 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
     iterator it = findKey<TStringRef>(key);
     if (it == end()) {
       // add the key
+      _index = NULL;
       it = Internals::List<JsonPair>::add();
       if (it == end()) return false;
       bool key_ok =
@@ -315,6 +370,9 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
 
   template <typename TStringRef>
   JsonObject& createNestedObject_impl(TStringRef key);
+
+  node_type** _index;  // NULL when not indexed
+  uint16_t _indexMask;
 };
 
 namespace Internals {
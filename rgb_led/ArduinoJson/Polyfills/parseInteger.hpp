@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "../Configuration.hpp"
@@ -17,6 +18,22 @@ T parseInteger(const char *s) {
 
   if (*s == 't') return 1;  // "true"
 
+  // fast path for the short unsigned integers (color channels, durations):
+  // up to 9 digits fit in 32 bits whatever T is, T(value) then wraps the same
+  // way as the digit by digit loop below
+  if (isdigit(*s)) {
+    uint32_t value = uint32_t(*s++ - '0');
+    for (uint8_t n = 1; n < 9 && isdigit(*s); n++)
+      value = value * 10 + uint32_t(*s++ - '0');
+    if (!isdigit(*s)) return T(value);
+    T result = T(value);
+    while (isdigit(*s)) {
+      result = T(result * 10 + T(*s - '0'));
+      s++;
+    }
+    return result;
+  }
+
   T result = 0;
   bool negative_result = false;
 
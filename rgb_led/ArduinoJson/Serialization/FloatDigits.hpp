@@ -0,0 +1,242 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>  // for memcpy
+
+#include "../Configuration.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// Shortest decimal digits that read back to the same binary value.
+//
+// This is the Grisu2 algorithm (Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers", PLDI 2010): the value and
+// the two boundaries of its rounding interval are scaled by a cached power of
+// ten so that the digits can be generated with 64-bit integer arithmetic
+// only. The result always reads back to the same value and is the shortest
+// one in the vast majority of cases.
+//
+// The boundaries depend on the precision of the type, so a float is printed
+// with up to 9 digits and a double with up to 17, "0.1f" gives "0.1".
+//
+// value = digits * 10^exponent, the value must be finite and > 0
+struct FloatDigits {
+  char digits[18];
+  int8_t length;
+  int16_t exponent;
+
+  explicit FloatDigits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    init(bits, 24, 127);
+  }
+
+  explicit FloatDigits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    init(bits, 53, 1023);
+  }
+
+ private:
+  // a floating point number f * 2^e with a 64-bit significand
+  struct DiyFp {
+    uint64_t f;
+    int e;
+
+    DiyFp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+    // x - y, both with the same exponent and x.f >= y.f
+    static DiyFp sub(const DiyFp& x, const DiyFp& y) {
+      return DiyFp(x.f - y.f, x.e);
+    }
+
+    // x * y, the 128-bit product rounded to its upper 64 bits
+    static DiyFp mul(const DiyFp& x, const DiyFp& y) {
+      uint64_t u_lo = x.f & 0xFFFFFFFFu;
+      uint64_t u_hi = x.f >> 32;
+      uint64_t v_lo = y.f & 0xFFFFFFFFu;
+      uint64_t v_hi = y.f >> 32;
+
+      uint64_t p0 = u_lo * v_lo;
+      uint64_t p1 = u_lo * v_hi;
+      uint64_t p2 = u_hi * v_lo;
+      uint64_t p3 = u_hi * v_hi;
+
+      uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+      q += uint64_t(1) << 31;  // round, ties up
+
+      return DiyFp(p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32), x.e + y.e + 64);
+    }
+
+    static DiyFp normalize(DiyFp x) {
+      while ((x.f >> 63) == 0) {
+        x.f <<= 1;
+        x.e--;
+      }
+      return x;
+    }
+
+    static DiyFp normalizeTo(const DiyFp& x, int e) {
+      return DiyFp(x.f << (x.e - e), e);
+    }
+  };
+
+  struct CachedPower {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+  };
+
+  // the scaled value has a binary exponent in [-60, -32], so that the
+  // integral part fits in 32 bits and the fractional part in 60
+  enum { kAlpha = -60 };
+
+  // 10^k normalized, for k = -300, -292, ... 324
+  static CachedPower cachedPower(int e) {
+    static const CachedPower powers[] = {
+        {0xAB70FE17C79AC6CA, -1060, -300},  {0xFF77B1FCBEBCDC4F, -1034, -292},
+        {0xBE5691EF416BD60C, -1007, -284},  {0x8DD01FAD907FFC3C, -980, -276},
+        {0xD3515C2831559A83, -954, -268},   {0x9D71AC8FADA6C9B5, -927, -260},
+        {0xEA9C227723EE8BCB, -901, -252},   {0xAECC49914078536D, -874, -244},
+        {0x823C12795DB6CE57, -847, -236},   {0xC21094364DFB5637, -821, -228},
+        {0x9096EA6F3848984F, -794, -220},   {0xD77485CB25823AC7, -768, -212},
+        {0xA086CFCD97BF97F4, -741, -204},   {0xEF340A98172AACE5, -715, -196},
+        {0xB23867FB2A35B28E, -688, -188},   {0x84C8D4DFD2C63F3B, -661, -180},
+        {0xC5DD44271AD3CDBA, -635, -172},   {0x936B9FCEBB25C996, -608, -164},
+        {0xDBAC6C247D62A584, -582, -156},   {0xA3AB66580D5FDAF6, -555, -148},
+        {0xF3E2F893DEC3F126, -529, -140},   {0xB5B5ADA8AAFF80B8, -502, -132},
+        {0x87625F056C7C4A8B, -475, -124},   {0xC9BCFF6034C13053, -449, -116},
+        {0x964E858C91BA2655, -422, -108},   {0xDFF9772470297EBD, -396, -100},
+        {0xA6DFBD9FB8E5B88F, -369, -92},    {0xF8A95FCF88747D94, -343, -84},
+        {0xB94470938FA89BCF, -316, -76},    {0x8A08F0F8BF0F156B, -289, -68},
+        {0xCDB02555653131B6, -263, -60},    {0x993FE2C6D07B7FAC, -236, -52},
+        {0xE45C10C42A2B3B06, -210, -44},    {0xAA242499697392D3, -183, -36},
+        {0xFD87B5F28300CA0E, -157, -28},    {0xBCE5086492111AEB, -130, -20},
+        {0x8CBCCC096F5088CC, -103, -12},    {0xD1B71758E219652C, -77, -4},
+        {0x9C40000000000000, -50, 4},       {0xE8D4A51000000000, -24, 12},
+        {0xAD78EBC5AC620000, 3, 20},        {0x813F3978F8940984, 30, 28},
+        {0xC097CE7BC90715B3, 56, 36},       {0x8F7E32CE7BEA5C70, 83, 44},
+        {0xD5D238A4ABE98068, 109, 52},      {0x9F4F2726179A2245, 136, 60},
+        {0xED63A231D4C4FB27, 162, 68},      {0xB0DE65388CC8ADA8, 189, 76},
+        {0x83C7088E1AAB65DB, 216, 84},      {0xC45D1DF942711D9A, 242, 92},
+        {0x924D692CA61BE758, 269, 100},     {0xDA01EE641A708DEA, 295, 108},
+        {0xA26DA3999AEF774A, 322, 116},     {0xF209787BB47D6B85, 348, 124},
+        {0xB454E4A179DD1877, 375, 132},     {0x865B86925B9BC5C2, 402, 140},
+        {0xC83553C5C8965D3D, 428, 148},     {0x952AB45CFA97A0B3, 455, 156},
+        {0xDE469FBD99A05FE3, 481, 164},     {0xA59BC234DB398C25, 508, 172},
+        {0xF6C69A72A3989F5C, 534, 180},     {0xB7DCBF5354E9BECE, 561, 188},
+        {0x88FCF317F22241E2, 588, 196},     {0xCC20CE9BD35C78A5, 614, 204},
+        {0x98165AF37B2153DF, 641, 212},     {0xE2A0B5DC971F303A, 667, 220},
+        {0xA8D9D1535CE3B396, 694, 228},     {0xFB9B7CD9A4A7443C, 720, 236},
+        {0xBB764C4CA7A44410, 747, 244},     {0x8BAB8EEFB6409C1A, 774, 252},
+        {0xD01FEF10A657842C, 800, 260},     {0x9B10A4E5E9913129, 827, 268},
+        {0xE7109BFBA19C0C9D, 853, 276},     {0xAC2820D9623BF429, 880, 284},
+        {0x80444B5E7AA7CF85, 907, 292},     {0xBF21E44003ACDD2D, 933, 300},
+        {0x8E679C2F5E44FF8F, 960, 308},     {0xD433179D9C8CB841, 986, 316},
+        {0x9E19DB92B4E31BA9, 1013, 324},
+    };
+
+    // smallest k such that the scaled exponent is >= alpha, then the entry
+    // of the table just above it
+    int f = kAlpha - e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+    int index = (300 + k + 7) / 8;
+    return powers[index];
+  }
+
+  // number of decimal digits of n and the matching power of ten
+  static int largestPow10(uint32_t n, uint32_t& pow10) {
+    static const uint32_t powers[] = {1,         10,        100,     1000,
+                                      10000,     100000,    1000000, 10000000,
+                                      100000000, 1000000000};
+    int digits = 10;
+    while (digits > 1 && n < powers[digits - 1]) digits--;
+    pow10 = powers[digits - 1];
+    return digits;
+  }
+
+  // moves the last digit down while it stays in the interval and gets closer
+  // to the exact value
+  void roundLastDigit(uint64_t dist, uint64_t delta, uint64_t rest, uint64_t tenK) {
+    while (rest < dist && delta - rest >= tenK &&
+           (rest + tenK < dist || dist - rest > rest + tenK - dist)) {
+      digits[length - 1]--;
+      rest += tenK;
+    }
+  }
+
+  void generate(const DiyFp& mMinus, const DiyFp& w, const DiyFp& mPlus) {
+    uint64_t delta = DiyFp::sub(mPlus, mMinus).f;
+    uint64_t dist = DiyFp::sub(mPlus, w).f;
+
+    // split mPlus in its integral part p1 and its fractional part p2
+    const int shift = -mPlus.e;
+    const uint64_t one = uint64_t(1) << shift;
+    uint32_t p1 = uint32_t(mPlus.f >> shift);
+    uint64_t p2 = mPlus.f & (one - 1);
+
+    uint32_t pow10;
+    int n = largestPow10(p1, pow10);
+    while (n > 0) {
+      digits[length++] = char('0' + p1 / pow10);
+      p1 %= pow10;
+      n--;
+      uint64_t rest = (uint64_t(p1) << shift) + p2;
+      if (rest <= delta) {
+        exponent = int16_t(exponent + n);
+        roundLastDigit(dist, delta, rest, uint64_t(pow10) << shift);
+        return;
+      }
+      pow10 /= 10;
+    }
+
+    int m = 0;
+    for (;;) {
+      p2 *= 10;
+      digits[length++] = char('0' + (p2 >> shift));
+      p2 &= one - 1;
+      m++;
+      delta *= 10;
+      dist *= 10;
+      if (p2 <= delta) break;
+    }
+    exponent = int16_t(exponent - m);
+    roundLastDigit(dist, delta, p2, one);
+  }
+
+  template <typename TBits>
+  void init(TBits bits, int precision, int exponentBias) {
+    const int bias = exponentBias + precision - 1;
+    const uint64_t hiddenBit = uint64_t(1) << (precision - 1);
+
+    int e = int(bits >> (precision - 1));
+    uint64_t f = uint64_t(bits) & (hiddenBit - 1);
+
+    // the value and the boundaries of its rounding interval
+    DiyFp v = e == 0 ? DiyFp(f, 1 - bias) : DiyFp(f + hiddenBit, e - bias);
+    bool lowerIsCloser = f == 0 && e > 1;
+    DiyFp plus = DiyFp::normalize(DiyFp(2 * v.f + 1, v.e - 1));
+    DiyFp minus = lowerIsCloser ? DiyFp(4 * v.f - 1, v.e - 2)
+                                : DiyFp(2 * v.f - 1, v.e - 1);
+    minus = DiyFp::normalizeTo(minus, plus.e);
+    v = DiyFp::normalize(v);
+
+    CachedPower cached = cachedPower(plus.e);
+    DiyFp c(cached.f, cached.e);
+    DiyFp w = DiyFp::mul(v, c);
+    DiyFp wMinus = DiyFp::mul(minus, c);
+    DiyFp wPlus = DiyFp::mul(plus, c);
+
+    // stay inside the interval despite the rounding of mul()
+    length = 0;
+    exponent = int16_t(-cached.k);
+    generate(DiyFp(wMinus.f + 1, wMinus.e), w, DiyFp(wPlus.f - 1, wPlus.e));
+  }
+};
+}  // namespace Internals
+}  // namespace ArduinoJson
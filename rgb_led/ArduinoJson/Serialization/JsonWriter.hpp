@@ -8,7 +8,8 @@
 #include "../Data/Encoding.hpp"
 #include "../Data/JsonInteger.hpp"
 #include "../Polyfills/attributes.hpp"
-#include "../Serialization/FloatParts.hpp"
+#include "../Polyfills/math.hpp"
+#include "../Serialization/FloatDigits.hpp"
 
 namespace ArduinoJson {
 namespace Internals {
@@ -88,53 +89,105 @@ class JsonWriter {
 
     if (isInfinity(value)) return writeRaw("Infinity");
 
-    FloatParts<TFloat> parts(value);
+    if (value == 0) return writeRaw('0');
 
-    writeInteger(parts.integral);
-    if (parts.decimalPlaces) writeDecimals(parts.decimal, parts.decimalPlaces);
-
-    if (parts.exponent < 0) {
-      writeRaw("e-");
-      writeInteger(-parts.exponent);
-    }
-
-    if (parts.exponent > 0) {
-      writeRaw('e');
-      writeInteger(parts.exponent);
-    }
+    bool scientific = value >= ARDUINOJSON_POSITIVE_EXPONENTIATION_THRESHOLD ||
+                      value <= ARDUINOJSON_NEGATIVE_EXPONENTIATION_THRESHOLD;
+    // the shortest digits that read back to the same value of TFloat, a float
+    // stored in a double JsonFloat gets the digits of the double, see
+    // JsonFloat.hpp
+    writeDigits(FloatDigits(value), scientific);
   }
 
   template <typename UInt>
   void writeInteger(UInt value) {
     char buffer[22];
-    char *end = buffer + sizeof(buffer) - 1;
-    char *ptr = end;
-
+    char *ptr = buffer + sizeof(buffer) - 1;
     *ptr = 0;
-    do {
-      *--ptr = char(value % 10 + '0');
-      value = UInt(value / 10);
-    } while (value);
+
+    // 64-bit divisions are library calls on 32-bit targets, only use them
+    // until the value fits in 32 bits
+    while (sizeof(UInt) > 4 && value > UInt(0xFFFFFFFF)) {
+      ptr = writePair(ptr, uint32_t(value % 100));
+      value = UInt(value / 100);
+    }
+
+    uint32_t value32 = uint32_t(value);
+    while (value32 >= 100) {
+      ptr = writePair(ptr, value32 % 100);
+      value32 /= 100;
+    }
+    if (value32 >= 10)
+      ptr = writePair(ptr, value32);
+    else
+      *--ptr = char('0' + value32);
 
     writeRaw(ptr);
   }
 
-  void writeDecimals(uint32_t value, int8_t width) {
-    // buffer should be big enough for all digits, the dot and the null
-    // terminator
-    char buffer[16];
-    char *ptr = buffer + sizeof(buffer) - 1;
+  // writes the two digits of pair (< 100) before ptr
+  static char *writePair(char *ptr, uint32_t pair) {
+    static const char digits[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+    *--ptr = digits[2 * pair + 1];
+    *--ptr = digits[2 * pair];
+    return ptr;
+  }
 
-    // write the string in reverse order
-    *ptr = 0;
-    while (width--) {
-      *--ptr = char(value % 10 + '0');
-      value /= 10;
+  void writeDigits(const FloatDigits &parts, bool scientific) {
+    // 17 digits, up to 4 leading zeros or 6 trailing zeros, the dot, the
+    // exponent and the null terminator
+    char buffer[32];
+    char *ptr = buffer;
+    const char *digits = parts.digits;
+    int length = parts.length;
+    int point = length + parts.exponent;  // digits before the dot
+
+    if (scientific) {
+      *ptr++ = digits[0];
+      if (length > 1) {
+        *ptr++ = '.';
+        for (int i = 1; i < length; i++) *ptr++ = digits[i];
+      }
+      int exponent = point - 1;
+      *ptr++ = 'e';
+      if (exponent < 0) {
+        *ptr++ = '-';
+        exponent = -exponent;
+      }
+      char *start = ptr;
+      do {
+        *ptr++ = char('0' + exponent % 10);
+        exponent /= 10;
+      } while (exponent);
+      for (char *end = ptr - 1; start < end; start++, end--) {
+        char c = *start;
+        *start = *end;
+        *end = c;
+      }
+    } else if (point <= 0) {
+      *ptr++ = '0';
+      *ptr++ = '.';
+      while (point++ < 0) *ptr++ = '0';
+      for (int i = 0; i < length; i++) *ptr++ = digits[i];
+    } else {
+      for (int i = 0; i < length; i++) {
+        if (i == point) *ptr++ = '.';
+        *ptr++ = digits[i];
+      }
+      while (point-- > length) *ptr++ = '0';
     }
-    *--ptr = '.';
-
-    // and dump it in the right order
-    writeRaw(ptr);
+    *ptr = 0;
+    writeRaw(buffer);
   }
 
   void writeRaw(const char *s) {
@@ -0,0 +1,93 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+namespace ArduinoJson {
+namespace Internals {
+
+// A string given by a pointer and a length, it does not need a terminator.
+// Used to parse a received payload where it is, without copying it into a
+// null terminated buffer first.
+template <typename TChar>
+class SizedString {
+ public:
+  SizedString(TChar* ptr, size_t size) : _ptr(ptr), _size(ptr ? size : 0) {}
+
+  TChar* ptr() const {
+    return _ptr;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+ private:
+  TChar* _ptr;
+  size_t _size;
+};
+
+template <typename TChar>
+struct StringTraits<SizedString<TChar>, void> {
+  // reads '\0' past the end, which the parser handles as the end of input
+  class Reader {
+    const TChar* _ptr;
+    const TChar* _end;
+
+   public:
+    Reader(const SizedString<TChar>& str)
+        : _ptr(str.ptr()), _end(str.ptr() + str.size()) {}
+
+    void move() {
+      if (_ptr < _end) ++_ptr;
+    }
+
+    char current() const {
+      return _ptr < _end ? char(_ptr[0]) : '\0';
+    }
+
+    char next() const {
+      return _ptr + 1 < _end ? char(_ptr[1]) : '\0';
+    }
+  };
+
+  static bool equals(const SizedString<TChar>& str, const char* expected) {
+    if (!str.ptr() || !expected) return !str.ptr() && !expected;
+    return strlen(expected) == str.size() &&
+           memcmp(str.ptr(), expected, str.size()) == 0;
+  }
+
+  static bool is_null(const SizedString<TChar>& str) {
+    return !str.ptr();
+  }
+
+  typedef const char* duplicate_t;
+
+  template <typename Buffer>
+  static duplicate_t duplicate(const SizedString<TChar>& str, Buffer* buffer) {
+    if (!str.ptr()) return NULL;
+    char* dup = static_cast<char*>(buffer->alloc(str.size() + 1));
+    if (dup == NULL) return NULL;
+    memcpy(dup, str.ptr(), str.size());
+    dup[str.size()] = '\0';
+    return dup;
+  }
+
+  static const bool has_append = false;
+  static const bool has_equals = true;
+  static const bool should_duplicate = true;
+};
+}  // namespace Internals
+
+// jsonBuffer.parseObject(SizedJson(event->data, event->data_len));
+//
+// Like with a char*, a mutable buffer is parsed in place: the strings are
+// decoded in it and the JsonObject points into it, so the buffer must outlive
+// the JsonObject. A const buffer is left untouched and the strings are copied
+// in the JsonBuffer.
+template <typename TChar>
+inline Internals::SizedString<TChar> SizedJson(TChar* ptr, size_t size) {
+  return Internals::SizedString<TChar>(ptr, size);
+}
+}  // namespace ArduinoJson
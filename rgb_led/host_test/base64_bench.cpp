@@ -0,0 +1,152 @@
+// Base64Decoder against the std::string decoder it replaced, on a 256 pixels
+// frame
+//
+// The decoder is first checked against GeneralUtils::base64Encode() on random
+// data, padded and unpadded, in one call and in random chunks.
+
+#include <GeneralUtils.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+
+// the std::string decoder of GeneralUtils before Base64Decoder, as reference
+namespace reference {
+static void a4_to_a3(unsigned char* a3, unsigned char* a4) {
+  a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
+  a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
+  a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
+}
+
+static int decoded_length(const std::string& in) {
+  int numEq = 0;
+  int n = (int)in.size();
+  for (std::string::const_reverse_iterator it = in.rbegin(); *it == '='; ++it)
+    ++numEq;
+  return ((6 * n) / 8) - numEq;
+}
+
+static unsigned char b64_lookup(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 71;
+  if (c >= '0' && c <= '9') return c + 4;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return 255;
+}
+
+static bool base64Decode(const std::string& in, std::string* out) {
+  int i = 0, j = 0;
+  size_t dec_len = 0;
+  unsigned char a3[3];
+  unsigned char a4[4];
+  int input_len = in.size();
+  std::string::const_iterator input = in.begin();
+  out->resize(decoded_length(in));
+  while (input_len--) {
+    if (*input == '=') break;
+    a4[i++] = *(input++);
+    if (i == 4) {
+      for (i = 0; i < 4; i++) a4[i] = b64_lookup(a4[i]);
+      a4_to_a3(a3, a4);
+      for (i = 0; i < 3; i++) (*out)[dec_len++] = a3[i];
+      i = 0;
+    }
+  }
+  if (i) {
+    for (j = i; j < 4; j++) a4[j] = '\0';
+    for (j = 0; j < 4; j++) a4[j] = b64_lookup(a4[j]);
+    a4_to_a3(a3, a4);
+    for (j = 0; j < i - 1; j++) (*out)[dec_len++] = a3[j];
+  }
+  return (dec_len == out->size());
+}
+}  // namespace reference
+
+static void check_decoder() {
+  std::mt19937 random(1);
+  for (int test = 0; test < 20000; test++) {
+    size_t length = random() % 64;
+    std::string data;
+    for (size_t i = 0; i < length; i++) data += char(random());
+    std::string padded;
+    GeneralUtils::base64Encode(data, &padded);
+    std::string unpadded = padded.substr(0, padded.find('='));
+    const std::string* encodings[] = {&padded, &unpadded};
+    for (int e = 0; e < 2; e++) {
+      const std::string& text = *encodings[e];
+      std::string out;
+      CHECK(GeneralUtils::base64Decode(text, &out));
+      CHECK(out == data);
+
+      // random chunks, not aligned on quads
+      Base64Decoder decoder;
+      std::vector<uint8_t> buffer(length + 8);
+      size_t in = 0, written = 0;
+      while (in < text.size()) {
+        size_t chunk = random() % 7;
+        if (chunk > text.size() - in) chunk = text.size() - in;
+        int n = decoder.decode(text.data() + in, chunk, buffer.data() + written,
+                               Base64Decoder::maxDecodedLength(chunk));
+        CHECK(n >= 0);
+        written += n;
+        in += chunk;
+      }
+      int n = decoder.finish(buffer.data() + written, 2);
+      CHECK(n >= 0);
+      written += n;
+      CHECK(written == length &&
+            memcmp(buffer.data(), data.data(), length) == 0);
+
+      // an exact output buffer is enough, one byte less is refused
+      std::vector<uint8_t> exact(length);
+      CHECK(GeneralUtils::base64Decode(text.data(), text.size(), exact.data(),
+                                       length) == (int)length);
+      if (length > 0)
+        CHECK(GeneralUtils::base64Decode(text.data(), text.size(), exact.data(),
+                                         length - 1) == -1);
+    }
+  }
+  const char* invalid[] = {"A",        "AB=C", "A===", "AB==C", "AB=",
+                           "AB==AB==", "****", "AB C", "ABC==", "=AAA"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    uint8_t out[16];
+    CHECK(GeneralUtils::base64Decode(invalid[i], strlen(invalid[i]), out,
+                                     sizeof(out)) == -1);
+  }
+}
+
+int main() {
+  check_decoder();
+
+  std::mt19937 random(2);
+  std::string pixels;
+  for (int i = 0; i < 768; i++) pixels += char(random());
+  std::string frame;
+  GeneralUtils::base64Encode(pixels, &frame);
+
+  long sum = 0;
+  uint8_t out[768];
+  double before = best_ns(
+      [&] {
+        std::string decoded;
+        reference::base64Decode(frame, &decoded);
+        sum += decoded.size();
+      },
+      20000);
+  double after = best_ns(
+      [&] {
+        sum += GeneralUtils::base64Decode(frame.data(), frame.size(), out,
+                                          sizeof(out));
+      },
+      20000);
+  CHECK(memcmp(out, pixels.data(), sizeof(out)) == 0);
+  printf("%u characters: std::string decoder %.3f us (%.0f MB/s), "
+         "Base64Decoder %.3f us (%.0f MB/s) (%ld)\n",
+         (unsigned)frame.size(), before / 1000, 768 * 1000 / before,
+         after / 1000, 768 * 1000 / after, sum);
+  return host_test_result();
+}
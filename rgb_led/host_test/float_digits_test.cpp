@@ -0,0 +1,98 @@
+// JsonWriter floats read back to the same value through strtod/strtof
+//
+// The JsonFloat of the host build is a double, as in the IDF config. The
+// float digits are checked through FloatDigits directly.
+//
+//   ./build/float_digits_test                1M random doubles and floats
+//   ./build/float_digits_test --exhaustive   also every positive finite float,
+//                                            about 13 minutes on one x86 core
+
+#include <ArduinoJson.hpp>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+using namespace ArduinoJson;
+using namespace ArduinoJson::Internals;
+
+static uint64_t xorshift(uint64_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static bool double_reads_back(double value) {
+  char out[64];
+  JsonVariant variant(value);
+  variant.printTo(out, sizeof(out));
+  return strtod(out, NULL) == value;
+}
+
+static bool float_reads_back(float value) {
+  char out[64];
+  FloatDigits digits(value);
+  memcpy(out, digits.digits, digits.length);
+  sprintf(out + digits.length, "e%d", digits.exponent);
+  return strtof(out, NULL) == value;
+}
+
+// the 2^31 - 2^23 - 1 positive finite floats, the subnormals included
+static int check_all_floats() {
+  int failures = 0;
+  for (uint32_t bits = 1; bits < 0x7F800000u; bits++) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if (!float_reads_back(value)) {
+      if (failures < 10) printf("FAIL float bits 0x%08X\n", bits);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  bool exhaustive = (argc > 1) && (strcmp(argv[1], "--exhaustive") == 0);
+  // doubles that a float holds exactly keep their double digits
+  const double samples[] = {3.0000001192092896, double(0.1f), 0.1, 1.5,
+                            2500,               1e-5,         1e21, 5e-324,
+                            1.7976931348623157e308};
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+    CHECK(double_reads_back(samples[i]));
+  char out[64];
+  JsonVariant(0.1).printTo(out, sizeof(out));
+  CHECK(strcmp(out, "0.1") == 0);
+  // a float widened to the double JsonFloat, see JsonFloat.hpp
+  JsonVariant(0.1f).printTo(out, sizeof(out));
+  CHECK(strcmp(out, "0.10000000149011612") == 0);
+  CHECK(strtod(out, NULL) == double(0.1f));
+  // the float digits of the same value
+  FloatDigits digits(0.1f);
+  CHECK(digits.length == 1 && digits.digits[0] == '1' && digits.exponent == -1);
+
+  uint64_t state = 88172645463325252ull;
+  int failures = 0;
+  for (int i = 0; i < 1000000; i++) {
+    uint64_t bits = xorshift(&state);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (isnan(value) || isinf(value)) continue;
+    if (!double_reads_back(value)) failures++;
+    uint32_t bits32 = uint32_t(bits >> 32);
+    float value32;
+    memcpy(&value32, &bits32, sizeof(value32));
+    value32 = fabsf(value32);
+    if (isnan(value32) || isinf(value32) || value32 == 0) continue;
+    if (!float_reads_back(value32)) failures++;
+  }
+  CHECK(failures == 0);
+  printf("1M random doubles and floats, %d not read back\n", failures);
+  if (exhaustive) {
+    int float_failures = check_all_floats();
+    CHECK(float_failures == 0);
+    printf("all positive finite floats, %d not read back\n", float_failures);
+  }
+  return host_test_result();
+}
@@ -0,0 +1,64 @@
+// GPIOBus::write() and GPIO::writeByte() through the register mock
+//
+// Every byte value is written on an 8 bits bus spread over both banks, the
+// pins of the bus must follow the value, the other pins must keep their
+// level, and each write is one set and one clear per bank used.
+
+#include <GPIO.h>
+
+#include "gpio_reg_mock.h"
+#include "host_test.h"
+
+gpio_reg_mock_t gpio_reg_mock;
+
+static uint64_t expected_state(const gpio_num_t* pins, int bits, uint8_t value,
+                               uint64_t state) {
+  for (int i = 0; i < bits; i++) {
+    uint64_t bit = 1ull << pins[i];
+    if (value & (1 << i))
+      state |= bit;
+    else
+      state &= ~bit;
+  }
+  return state;
+}
+
+int main() {
+  const gpio_num_t pins[8] = {GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14,
+                              GPIO_NUM_15, GPIO_NUM_25, GPIO_NUM_26,
+                              GPIO_NUM_32, GPIO_NUM_33};
+  ESP32CPP::GPIOBus bus(pins, 8);
+  // pins out of the bus, in both banks
+  gpio_reg_mock.out[0] = 0x80000001;
+  gpio_reg_mock.out[1] = 0x10;
+  uint64_t state = gpio_reg_mock.state();
+
+  for (int value = 0; value < 256; value++) {
+    int writes = gpio_reg_mock.writes;
+    bus.write(value);
+    state = expected_state(pins, 8, value, state);
+    CHECK(gpio_reg_mock.state() == state);
+    CHECK(gpio_reg_mock.writes - writes == 4);
+  }
+  gpio_num_t byte_pins[8];
+  for (int i = 0; i < 8; i++) byte_pins[i] = pins[i];
+  for (int value = 0; value < 256; value++) {
+    ESP32CPP::GPIO::writeByte(byte_pins, value, 8);
+    state = expected_state(pins, 8, value, state);
+    CHECK(gpio_reg_mock.state() == state);
+  }
+
+  // a bus of the first bank only does not write the second one
+  const gpio_num_t low_pins[4] = {GPIO_NUM_0, GPIO_NUM_2, GPIO_NUM_4,
+                                  GPIO_NUM_5};
+  ESP32CPP::GPIOBus low_bus(low_pins, 4);
+  for (int value = 0; value < 16; value++) {
+    int writes = gpio_reg_mock.writes;
+    low_bus.write(value);
+    state = expected_state(low_pins, 4, value, state);
+    CHECK(gpio_reg_mock.state() == state);
+    CHECK(gpio_reg_mock.writes - writes == 2);
+  }
+  printf("256 values on two banks, %d register writes\n", gpio_reg_mock.writes);
+  return host_test_result();
+}
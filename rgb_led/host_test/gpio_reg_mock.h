@@ -0,0 +1,39 @@
+// Host mock of the GPIO output registers, included before GPIO.cpp so that its
+// GPIO_REG_WRITE goes here: the W1TS/W1TC writes are applied to the output
+// state of the two banks (GPIO 0-31 and 32-39) and counted.
+
+#pragma once
+
+#include <soc/gpio_reg.h>
+#include <stdint.h>
+
+struct gpio_reg_mock_t {
+  uint32_t out[2];
+  int writes;
+
+  uint64_t state() const {
+    return (uint64_t(out[1]) << 32) | out[0];
+  }
+};
+
+extern gpio_reg_mock_t gpio_reg_mock;
+
+inline void gpio_reg_mock_write(uint32_t reg, uint32_t value) {
+  gpio_reg_mock.writes++;
+  switch (reg) {
+    case GPIO_OUT_W1TS_REG:
+      gpio_reg_mock.out[0] |= value;
+      break;
+    case GPIO_OUT_W1TC_REG:
+      gpio_reg_mock.out[0] &= ~value;
+      break;
+    case GPIO_OUT1_W1TS_REG:
+      gpio_reg_mock.out[1] |= value;
+      break;
+    case GPIO_OUT1_W1TC_REG:
+      gpio_reg_mock.out[1] &= ~value;
+      break;
+  }
+}
+
+#define GPIO_REG_WRITE(reg, value) gpio_reg_mock_write(reg, value)
@@ -0,0 +1,50 @@
+// host definitions of the IDF functions the rgb_led sources under test call
+
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <string.h>
+
+extern "C" void esp_chip_info(esp_chip_info_t* out_info) {
+  memset(out_info, 0, sizeof(esp_chip_info_t));
+}
+
+extern "C" const char* esp_get_idf_version(void) {
+  return "host";
+}
+
+extern "C" size_t heap_caps_get_free_size(uint32_t) {
+  return 0;
+}
+
+extern "C" esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) {
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_set_level(gpio_num_t, uint32_t) {
+  return ESP_OK;
+}
+
+extern "C" int gpio_get_level(gpio_num_t) {
+  return 0;
+}
+
+extern "C" esp_err_t gpio_set_intr_type(gpio_num_t, gpio_int_type_t) {
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_intr_enable(gpio_num_t) {
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_intr_disable(gpio_num_t) {
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_install_isr_service(int) {
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*) {
+  return ESP_OK;
+}
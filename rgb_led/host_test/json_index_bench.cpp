@@ -0,0 +1,83 @@
+// JsonObject key lookups, linear search against the key index
+//
+// The index is built by the parser for objects of
+// ARDUINOJSON_OBJECT_INDEX_THRESHOLD keys or more, and dropped when a key is
+// added or removed, which gives the linear search on the same object.
+
+#include <ArduinoJson.hpp>
+#include <string.h>
+
+#include <string>
+
+#include "host_test.h"
+
+using namespace ArduinoJson;
+
+static void check_lookups() {
+  DynamicJsonBuffer buffer;
+  JsonObject& object = buffer.parseObject(
+      "{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9}");
+  CHECK(object.success());
+  const char* keys = "abcdefghi";
+  for (int i = 0; i < 9; i++) {
+    char key[2] = {keys[i], 0};
+    CHECK(object[key] == i + 1);
+    CHECK(object.containsKey(std::string(key)));
+  }
+  CHECK(!object.containsKey("z"));
+  CHECK(object["z"] == 0);
+  // a new key drops the index, the lookups fall back to the linear search
+  object["j"] = 10;
+  CHECK(object["j"] == 10 && object["a"] == 1);
+  object.remove("c");
+  CHECK(!object.containsKey("c") && object["i"] == 9);
+  // and it can be rebuilt
+  CHECK(object.buildIndex());
+  CHECK(object["h"] == 8 && !object.containsKey("c") && object["j"] == 10);
+  object["a"] = 42;
+  CHECK(object["a"] == 42);
+  CHECK(object.get<int>(SizedJson("hxx", 1)) == 8);
+}
+
+static void bench_width(int width) {
+  std::string json = "{";
+  char keys[64][16];
+  for (int i = 0; i < width; i++) {
+    char member[32];
+    sprintf(keys[i], "key_%02d", i);
+    sprintf(member, "%s\"%s\":%d", i ? "," : "", keys[i], i);
+    json += member;
+  }
+  json += "}";
+
+  double ns[2];
+  for (int indexed = 0; indexed < 2; indexed++) {
+    DynamicJsonBuffer buffer;
+    JsonObject& object = buffer.parseObject(json.c_str());
+    if (indexed) {
+      object.buildIndex();
+    } else {
+      object["x"] = 0;
+      object.remove("x");
+    }
+    long sum = 0;
+    ns[indexed] = best_ns(
+                      [&] {
+                        for (int i = 0; i < width; i++)
+                          sum += object[(const char*)keys[i]].as<int>();
+                      },
+                      200000 / width) /
+                  width;
+    CHECK(sum % (width * (width - 1) / 2) == 0);
+  }
+  printf("width %2d: %6.1f ns linear, %6.1f ns indexed\n", width, ns[0],
+         ns[1]);
+}
+
+int main() {
+  check_lookups();
+  const int widths[] = {4, 8, 10, 16, 32, 64};
+  for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++)
+    bench_width(widths[i]);
+  return host_test_result();
+}
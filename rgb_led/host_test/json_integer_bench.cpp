@@ -0,0 +1,74 @@
+// Integer paths of the parser and the writer, on the 768 color channels of a
+// 256 leds pixels/list
+
+#include <ArduinoJson.hpp>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+using namespace ArduinoJson;
+
+static char list[8192];
+static int list_length;
+static char channels[768][4];
+
+static void check_integers() {
+  // the 32-bit fast path of the parser, then the general loop
+  const char* texts[] = {"0",          "7",          "255",
+                         "999999999",  "1000000000", "4294967295",
+                         "4294967296", "18446744073709551615"};
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    StaticJsonBuffer<64> buffer;
+    JsonVariant value =
+        buffer.parse(SizedJson(texts[i], strlen(texts[i])));
+    CHECK(value.as<unsigned long long>() == strtoull(texts[i], NULL, 10));
+    CHECK(Internals::parseInteger<unsigned long long>(texts[i]) ==
+          strtoull(texts[i], NULL, 10));
+    char out[32];
+    value.printTo(out, sizeof(out));
+    CHECK(strcmp(out, texts[i]) == 0);
+  }
+}
+
+int main() {
+  check_integers();
+
+  unsigned seed = 12345;
+  list_length = sprintf(list, "[");
+  for (int i = 0; i < 768; i++) {
+    seed = seed * 1103515245 + 12345;
+    unsigned channel = (seed >> 16) % 256;
+    list_length += sprintf(list + list_length, "%s%u", i ? "," : "", channel);
+    sprintf(channels[i], "%u", channel);
+  }
+  list_length += sprintf(list + list_length, "]");
+
+  static DynamicJsonBuffer buffer(32768);
+  JsonArray& array = buffer.parseArray(SizedJson(list, list_length));
+  CHECK(array.success() && array.size() == 768);
+
+  long sum = 0;
+  static char out[8192];
+  double print = best_ns([&] { sum += array.printTo(out, sizeof(out)); }, 200);
+  CHECK(strcmp(out, list) == 0);
+  double parse_integer = best_ns(
+      [&] {
+        for (int i = 0; i < 768; i++)
+          sum += Internals::parseInteger<uint8_t>(channels[i]);
+      },
+      200);
+  double parser = best_ns(
+      [&] {
+        for (int i = 0; i < 768; i++) {
+          StaticJsonBuffer<16> value_buffer;
+          sum += value_buffer.parse(SizedJson(channels[i], strlen(channels[i])))
+                     .as<uint8_t>();
+        }
+      },
+      200);
+  printf("768 channels: print array %.2f us, parser values %.2f us, "
+         "parseInteger %.2f us (%ld)\n",
+         print / 1000, parser / 1000, parse_integer / 1000, sum);
+  return host_test_result();
+}
@@ -0,0 +1,190 @@
+// MessagePack reader against the JSON text parser, on a pixels/list object
+//
+// The MessagePack input is built by a small writer here, the reader is first
+// checked on every type it accepts, on truncated inputs and on the refused
+// ones.
+
+#include <ArduinoJson.hpp>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+
+using namespace ArduinoJson;
+
+struct MsgPackWriter {
+  std::vector<uint8_t> bytes;
+
+  void u8(uint8_t value) {
+    bytes.push_back(value);
+  }
+  void bigEndian(uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; i--) bytes.push_back(uint8_t(value >> (8 * i)));
+  }
+  void str(const char* value) {
+    size_t length = strlen(value);
+    if (length < 32) {
+      u8(uint8_t(0xA0 | length));
+    } else {
+      u8(0xD9);
+      u8(uint8_t(length));
+    }
+    bytes.insert(bytes.end(), value, value + length);
+  }
+  void uint(uint64_t value) {
+    if (value < 128) {
+      u8(uint8_t(value));
+    } else if (value < 256) {
+      u8(0xCC);
+      u8(uint8_t(value));
+    } else if (value < 65536) {
+      u8(0xCD);
+      bigEndian(value, 2);
+    } else if (value < (1ull << 32)) {
+      u8(0xCE);
+      bigEndian(value, 4);
+    } else {
+      u8(0xCF);
+      bigEndian(value, 8);
+    }
+  }
+  void sint(int64_t value) {
+    if (value >= -32) {
+      u8(uint8_t(value));
+    } else if (value >= -128) {
+      u8(0xD0);
+      u8(uint8_t(value));
+    } else if (value >= -32768) {
+      u8(0xD1);
+      bigEndian(uint16_t(value), 2);
+    } else {
+      u8(0xD2);
+      bigEndian(uint32_t(value), 4);
+    }
+  }
+  void float64(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u8(0xCB);
+    bigEndian(bits, 8);
+  }
+  void float32(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u8(0xCA);
+    bigEndian(bits, 4);
+  }
+};
+
+static void check_reader() {
+  MsgPackWriter writer;
+  writer.u8(0x8A);  // map of 10
+  writer.str("a"); writer.uint(5);
+  writer.str("b"); writer.sint(-5);
+  writer.str("c"); writer.uint(300);
+  writer.str("d"); writer.sint(-40000);
+  writer.str("e"); writer.float64(3.25);
+  writer.str("f"); writer.float32(0.5f);
+  writer.str("g"); writer.u8(0xC3);
+  writer.str("h"); writer.u8(0xC0);
+  writer.str("i"); writer.u8(0x92); writer.uint(1); writer.u8(0x81);
+  writer.str("x"); writer.str("a long string that is longer than 31 bytes");
+  writer.str("j"); writer.uint(1ull << 40);
+
+  DynamicJsonBuffer buffer;
+  JsonObject& object =
+      buffer.parseMsgPackObject(writer.bytes.data(), writer.bytes.size());
+  CHECK(object.success());
+  CHECK(object["a"].as<int>() == 5);
+  CHECK(object["b"].as<int>() == -5);
+  CHECK(object["c"].as<int>() == 300);
+  CHECK(object["d"].as<long>() == -40000);
+  CHECK(object["e"].as<double>() == 3.25);
+  CHECK(object["f"].as<float>() == 0.5f);
+  CHECK(object["g"].as<bool>());
+  CHECK(object["i"][1]["x"].as<std::string>() ==
+        "a long string that is longer than 31 bytes");
+  CHECK(object["j"].as<unsigned long long>() == (1ull << 40));
+
+  // a truncated input fails without reading past its end
+  for (size_t length = 0; length < writer.bytes.size(); length++) {
+    DynamicJsonBuffer truncated_buffer;
+    std::vector<uint8_t> truncated(writer.bytes.begin(),
+                                   writer.bytes.begin() + length);
+    CHECK(!truncated_buffer
+               .parseMsgPackObject(truncated.data(), truncated.size())
+               .success());
+  }
+  const uint8_t ext[] = {0x81, 0xA1, 'a', 0xD4, 1, 2};
+  CHECK(!buffer.parseMsgPackObject(ext, sizeof(ext)).success());
+  const uint8_t integer_key[] = {0x81, 0x01, 0x02};
+  CHECK(!buffer.parseMsgPackObject(integer_key, sizeof(integer_key)).success());
+  const uint8_t array16[] = {0xDC, 0x00, 0x02, 0x01, 0xFF};
+  JsonArray& array = buffer.parseMsgPackArray(array16, sizeof(array16));
+  CHECK(array.success() && array.size() == 2 && array[1].as<int>() == -1);
+  const uint8_t huge[] = {0xDD, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+  CHECK(!buffer.parseMsgPackArray(huge, sizeof(huge)).success());
+  std::vector<uint8_t> deep(60, 0x91);
+  deep.push_back(1);
+  CHECK(!buffer.parseMsgPackArray(deep.data(), deep.size()).success());
+}
+
+int main() {
+  check_reader();
+
+  // {"leds":[...]} with 300 values, as a pixels/list of 100 leds
+  const int values = 300;
+  std::string json = "{\"leds\":[";
+  MsgPackWriter writer;
+  writer.u8(0x81);
+  writer.str("leds");
+  writer.u8(0xDC);
+  writer.bigEndian(values, 2);
+  for (int i = 0; i < values; i++) {
+    int value = (i * 37) % 256;
+    json += std::to_string(value);
+    if (i < values - 1) json += ",";
+    writer.uint(value);
+  }
+  json += "]}";
+
+  {
+    DynamicJsonBuffer text_buffer, msgpack_buffer;
+    std::string text_out, msgpack_out;
+    text_buffer.parseObject(json).printTo(text_out);
+    msgpack_buffer
+        .parseMsgPackObject(writer.bytes.data(), writer.bytes.size())
+        .printTo(msgpack_out);
+    CHECK(text_out == msgpack_out && text_out == json);
+  }
+
+  // the text is decoded in place in the payload, as the MQTT handlers do, so
+  // it is copied to a scratch payload on every parse
+  static char payload[4096];
+  long sum = 0;
+  double text = best_ns(
+      [&] {
+        memcpy(payload, json.data(), json.size());
+        DynamicJsonBuffer buffer(8192);
+        sum += buffer.parseObject(SizedJson(payload, json.size()))["leds"]
+                   .size();
+      },
+      2000);
+  double msgpack = best_ns(
+      [&] {
+        DynamicJsonBuffer buffer(8192);
+        sum += buffer
+                   .parseMsgPackObject(writer.bytes.data(), writer.bytes.size())
+                   ["leds"]
+                   .size();
+      },
+      2000);
+  printf("pixels/list of 300 values: json %u bytes %.2f us, msgpack %u bytes "
+         "%.2f us (%ld)\n",
+         (unsigned)json.size(), text / 1000, (unsigned)writer.bytes.size(),
+         msgpack / 1000, sum);
+  return host_test_result();
+}
@@ -0,0 +1,16 @@
+// host declarations of the IDF, see host_stubs.cpp
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t heap_caps_get_free_size(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
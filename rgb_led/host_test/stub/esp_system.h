@@ -0,0 +1,21 @@
+// host declarations of the IDF, see host_stubs.cpp
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int model;
+    uint32_t features;
+    uint8_t cores;
+    uint8_t revision;
+} esp_chip_info_t;
+
+void esp_chip_info(esp_chip_info_t *out_info);
+const char *esp_get_idf_version(void);
+
+#ifdef __cplusplus
+}
+#endif
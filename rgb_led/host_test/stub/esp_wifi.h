@@ -0,0 +1,48 @@
+// host declarations of the IDF, the error codes only
+#pragma once
+#include "esp_err.h"
+
+#define ESP_ERR_WIFI_BASE       0x3000
+#define ESP_ERR_WIFI_NOT_INIT   (ESP_ERR_WIFI_BASE + 1)
+#define ESP_ERR_WIFI_NOT_START  (ESP_ERR_WIFI_BASE + 2)
+#define ESP_ERR_WIFI_IF         (ESP_ERR_WIFI_BASE + 3)
+#define ESP_ERR_WIFI_MODE       (ESP_ERR_WIFI_BASE + 4)
+#define ESP_ERR_WIFI_STATE      (ESP_ERR_WIFI_BASE + 5)
+#define ESP_ERR_WIFI_CONN       (ESP_ERR_WIFI_BASE + 6)
+#define ESP_ERR_WIFI_NVS        (ESP_ERR_WIFI_BASE + 7)
+#define ESP_ERR_WIFI_MAC        (ESP_ERR_WIFI_BASE + 8)
+#define ESP_ERR_WIFI_SSID       (ESP_ERR_WIFI_BASE + 9)
+#define ESP_ERR_WIFI_PASSWORD   (ESP_ERR_WIFI_BASE + 10)
+#define ESP_ERR_WIFI_TIMEOUT    (ESP_ERR_WIFI_BASE + 11)
+#define ESP_ERR_WIFI_WAKE_FAIL  (ESP_ERR_WIFI_BASE + 12)
+
+typedef enum {
+    WIFI_REASON_UNSPECIFIED              = 1,
+    WIFI_REASON_AUTH_EXPIRE              = 2,
+    WIFI_REASON_AUTH_LEAVE               = 3,
+    WIFI_REASON_ASSOC_EXPIRE             = 4,
+    WIFI_REASON_ASSOC_TOOMANY            = 5,
+    WIFI_REASON_NOT_AUTHED               = 6,
+    WIFI_REASON_NOT_ASSOCED              = 7,
+    WIFI_REASON_ASSOC_LEAVE              = 8,
+    WIFI_REASON_ASSOC_NOT_AUTHED         = 9,
+    WIFI_REASON_DISASSOC_PWRCAP_BAD      = 10,
+    WIFI_REASON_DISASSOC_SUPCHAN_BAD     = 11,
+    WIFI_REASON_IE_INVALID               = 13,
+    WIFI_REASON_MIC_FAILURE              = 14,
+    WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT   = 15,
+    WIFI_REASON_GROUP_KEY_UPDATE_TIMEOUT = 16,
+    WIFI_REASON_IE_IN_4WAY_DIFFERS       = 17,
+    WIFI_REASON_GROUP_CIPHER_INVALID     = 18,
+    WIFI_REASON_PAIRWISE_CIPHER_INVALID  = 19,
+    WIFI_REASON_AKMP_INVALID             = 20,
+    WIFI_REASON_UNSUPP_RSN_IE_VERSION    = 21,
+    WIFI_REASON_INVALID_RSN_IE_CAP       = 22,
+    WIFI_REASON_802_1X_AUTH_FAILED       = 23,
+    WIFI_REASON_CIPHER_SUITE_REJECTED    = 24,
+    WIFI_REASON_BEACON_TIMEOUT           = 200,
+    WIFI_REASON_NO_AP_FOUND              = 201,
+    WIFI_REASON_AUTH_FAIL                = 202,
+    WIFI_REASON_ASSOC_FAIL               = 203,
+    WIFI_REASON_HANDSHAKE_TIMEOUT        = 204,
+} wifi_err_reason_t;
@@ -0,0 +1,2 @@
+// host declarations of the IDF, nothing is used from it
+#pragma once
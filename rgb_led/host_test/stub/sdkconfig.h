@@ -0,0 +1,2 @@
+// host declarations of the IDF, no option is used
+#pragma once
@@ -0,0 +1,7 @@
+// host declarations of the IDF, the output set and clear registers of the two banks
+#pragma once
+
+#define GPIO_OUT_W1TS_REG   0x3FF44008
+#define GPIO_OUT_W1TC_REG   0x3FF4400C
+#define GPIO_OUT1_W1TS_REG  0x3FF44014
+#define GPIO_OUT1_W1TC_REG  0x3FF44018
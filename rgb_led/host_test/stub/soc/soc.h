@@ -0,0 +1,5 @@
+// host declarations of the IDF, the register writes go to gpio_reg_mock.h on the host
+#pragma once
+#include <stdint.h>
+
+#define REG_WRITE(reg, value) (*(volatile uint32_t *)(reg)) = (value)
@@ -0,0 +1,80 @@
+// Tokenizer against GeneralUtils::split() on an MQTT topic
+//
+// The tokens are first checked to be the ones of split(), on topics and on
+// comma lists with empty and blank tokens.
+
+#include <GeneralUtils.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+
+static void check_tokens(const char* source, char delimiter) {
+  std::vector<std::string> expected = GeneralUtils::split(source, delimiter);
+  Tokenizer tokenizer(source, strlen(source), delimiter);
+  StringView token;
+  size_t count = 0;
+  while (tokenizer.next(&token)) {
+    CHECK(count < expected.size());
+    if (count < expected.size())
+      CHECK(std::string(token.ptr, token.length) == expected[count]);
+    count++;
+  }
+  CHECK(count == expected.size());
+}
+
+static void check_views() {
+  CHECK(StringView("Pixels").equalsIgnoreCase("pIXELS"));
+  CHECK(!StringView("Pixel").equalsIgnoreCase("pixels"));
+  CHECK(!StringView("Pixels").equalsIgnoreCase("pixel"));
+  CHECK(StringView("one", 3).equals("one"));
+  CHECK(!StringView("one", 2).equals("one"));
+  CHECK(!StringView("on\0e", 4).equals("on"));
+  CHECK(StringView("ab/").endsWith('/'));
+  CHECK(!StringView("").endsWith('/'));
+  CHECK(StringView(NULL).empty());
+  StringView trimmed = StringView("  2.5 ").trim();
+  CHECK(trimmed.length == 3 && trimmed.equals("2.5"));
+}
+
+int main() {
+  check_tokens("esp/curvy/pixels/one", '/');
+  check_tokens("//a//", '/');
+  check_tokens(" a /b/ c  ", '/');
+  check_tokens("a,,b", ',');
+  check_tokens(" a , b ,", ',');
+  check_tokens("", ',');
+  check_tokens(",", ',');
+  check_tokens("x", ',');
+  check_views();
+
+  const char* topic = "esp/curvy/pixels/one";
+  size_t length = strlen(topic);
+  long matches = 0;
+  double split = best_ns(
+      [&] {
+        std::vector<std::string> levels =
+            GeneralUtils::split(std::string(topic, length), '/');
+        matches += levels.size() == 4 && levels[3] == "one";
+      },
+      100000);
+  double tokenizer = best_ns(
+      [&] {
+        Tokenizer levels(topic, length, '/');
+        StringView level;
+        int count = 0;
+        bool one = false;
+        while (levels.next(&level)) {
+          count++;
+          one = level.equals("one");
+        }
+        matches += count == 4 && one;
+      },
+      100000);
+  printf("\"%s\" split on '/', last level compared: split() %.1f ns, "
+         "Tokenizer %.1f ns (%ld)\n",
+         topic, split, tokenizer, matches);
+  return host_test_result();
+}
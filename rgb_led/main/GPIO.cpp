@@ -7,6 +7,9 @@
 
 #include "GPIO.h"
 #include <driver/gpio.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#include <string.h>
 #include "sdkconfig.h"
 #include <esp_log.h>
 #include <esp_err.h>
@@ -14,6 +17,28 @@
 
 static const char* LOG_TAG = "GPIO";
 
+// Writes on the host go to a mock by defining GPIO_REG_WRITE before the build,
+// see rgb_led/host_test/gpio_reg_mock.h
+#ifndef GPIO_REG_WRITE
+#define GPIO_REG_WRITE(reg, value) REG_WRITE(reg, value)
+#endif
+
+/**
+ * @brief Set and clear the output pins of both banks, GPIO 0-31 then GPIO 32-39.
+ * @param [in] set The pins to set high, per bank.
+ * @param [in] mask The pins written, those not in set go low.
+ */
+static void writeBanks(const uint32_t set[2], const uint32_t mask[2]) {
+	if (mask[0]) {
+		GPIO_REG_WRITE(GPIO_OUT_W1TS_REG, set[0]);
+		GPIO_REG_WRITE(GPIO_OUT_W1TC_REG, mask[0] & ~set[0]);
+	}
+	if (mask[1]) {
+		GPIO_REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]);
+		GPIO_REG_WRITE(GPIO_OUT1_W1TC_REG, mask[1] & ~set[1]);
+	}
+} // writeBanks
+
 static bool g_isrServiceInstalled = false;
 
 /**
@@ -193,10 +218,59 @@ void ESP32CPP::GPIO::write(gpio_num_t pin, bool value) {
  * @param [in] bits The number of bits to write.
  */
 void ESP32CPP::GPIO::writeByte(gpio_num_t pins[], uint8_t value, int bits) {
-	ESP_LOGD(LOG_TAG, ">> writeByte: value: %.2x, bits: %d", value, bits);
+	// all the pins in one write per register, see GPIOBus for a fixed group of pins
+	uint32_t set[2]  = {0, 0};
+	uint32_t mask[2] = {0, 0};
 	for (int i = 0; i < bits; i++) {
-		//ESP_LOGD(LOG_TAG, "i=%d, bits=%d", i, bits);
-		write(pins[i], (value & (1 << i)) != 0);
+		int bank = pins[i] / 32;
+		uint32_t bit = 1u << (pins[i] % 32);
+		mask[bank] |= bit;
+		if (value & (1 << i)) {
+			set[bank] |= bit;
+		}
 	}
-	ESP_LOGD(LOG_TAG, "<< writeByte");
+	writeBanks(set, mask);
 } // writeByte
+
+
+/**
+ * @brief Prepare the register masks of a bus.
+ *
+ * Ensure that the pins are set as output before writing to the bus.
+ * @param [in] pins The pins of the bus, the first one is the least significant bit.
+ * @param [in] bits The number of pins, up to 8.
+ */
+ESP32CPP::GPIOBus::GPIOBus(const gpio_num_t pins[], int bits) {
+	memset(m_lowSet, 0, sizeof(m_lowSet));
+	memset(m_highSet, 0, sizeof(m_highSet));
+	m_mask[0] = m_mask[1] = 0;
+	if (bits > 8) {
+		ESP_LOGE(LOG_TAG, "GPIOBus: %d pins, only the first 8 are used", bits);
+		bits = 8;
+	}
+	for (int i = 0; i < bits; i++) {
+		int bank = pins[i] / 32;
+		uint32_t bit = 1u << (pins[i] % 32);
+		m_mask[bank] |= bit;
+		for (int nibble = 0; nibble < 16; nibble++) {
+			if (i < 4 && (nibble & (1 << i))) {
+				m_lowSet[bank][nibble] |= bit;
+			}
+			if (i >= 4 && (nibble & (1 << (i - 4)))) {
+				m_highSet[bank][nibble] |= bit;
+			}
+		}
+	}
+} // GPIOBus
+
+
+/**
+ * @brief Write a value on the bus.
+ * @param [in] value The data value, bit i goes to pins[i].
+ */
+void ESP32CPP::GPIOBus::write(uint8_t value) {
+	uint32_t set[2];
+	set[0] = m_lowSet[0][value & 0x0F] | m_highSet[0][value >> 4];
+	set[1] = m_lowSet[1][value & 0x0F] | m_highSet[1][value >> 4];
+	writeBanks(set, m_mask);
+} // write
@@ -43,5 +43,31 @@ namespace ESP32CPP {
 		static void write(gpio_num_t pin, bool value);
 		static void writeByte(gpio_num_t pins[], uint8_t value, int bits);
 	}; // End GPIO
+
+	/**
+	 * @brief A group of up to 8 output pins written as one parallel bus.
+	 *
+	 * The register masks of every nibble value are computed once, so that writing a byte
+	 * is two table lookups and one write to the set and one to the clear register
+	 * (GPIO_OUT_W1TS / GPIO_OUT_W1TC), per bank of 32 pins used by the bus. The pins
+	 * going high change together, then the pins going low.
+	 *
+	 * @code{.cpp}
+	 * gpio_num_t pins[] = {GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15};
+	 * ESP32CPP::GPIOBus bus(pins, 4);
+	 * bus.write(0x05);
+	 * @endcode
+	 */
+	class GPIOBus {
+	public:
+		GPIOBus(const gpio_num_t pins[], int bits);
+		void write(uint8_t value);
+
+	private:
+		// [bank][nibble value] register bits set by the low and the high nibble
+		uint32_t m_lowSet[2][16];
+		uint32_t m_highSet[2][16];
+		uint32_t m_mask[2];
+	}; // End GPIOBus
 } // End ESP32CPP namespace
 #endif /* COMPONENTS_CPP_UTILS_GPIO_H_ */
@@ -13,15 +13,86 @@
 #include <algorithm>
 #include <vector>
 
+/**
+ * @brief Incremental base64 decoder into caller buffers, without allocation.
+ *
+ * @code{.cpp}
+ * Base64Decoder decoder;
+ * int n = decoder.decode(chunk, chunkLength, out, outSize); // for every chunk
+ * int last = decoder.finish(out + n, outSize - n);
+ * @endcode
+ */
+class Base64Decoder {
+public:
+	Base64Decoder();
+	void          reset();
+	int           decode(const char* in, size_t length, uint8_t* out, size_t outSize);
+	int           finish(uint8_t* out, size_t outSize);
+	static size_t maxDecodedLength(size_t length);
+
+private:
+	int           flushPartial(uint8_t* out, size_t outSize);
+
+	uint32_t m_bits;    // the pending sextets of the current quad
+	uint8_t  m_count;   // number of pending sextets
+	uint8_t  m_padding; // number of '=' seen
+	bool     m_ended;   // a padded quad ended the string
+	bool     m_error;
+};
+
+/**
+ * @brief A view of characters owned by someone else, not null terminated.
+ *
+ * Used to look at topic levels and text commands where they were received,
+ * without copying them into std::string.
+ */
+class StringView {
+public:
+	StringView();
+	StringView(const char* ptr, size_t length);
+	StringView(const char* text);
+	bool        empty() const;
+	bool        endsWith(char c) const;
+	bool        equals(const char* text) const;
+	bool        equalsIgnoreCase(const char* text) const;
+	StringView  trim() const;
+
+	const char* ptr;
+	size_t      length;
+};
+
+/**
+ * @brief Splits a string on a delimiter into trimmed views of it.
+ *
+ * @code{.cpp}
+ * Tokenizer levels(topic, topicLength, '/');
+ * StringView level;
+ * while (levels.next(&level)) {
+ *   if (level.equalsIgnoreCase("pixels")) ...
+ * }
+ * @endcode
+ */
+class Tokenizer {
+public:
+	Tokenizer(const char* source, size_t length, char delimiter);
+	bool next(StringView* token);
+
+private:
+	const char* m_ptr;
+	const char* m_end;
+	char        m_delimiter;
+};
+
 /**
  * @brief General utilities.
  */
 class GeneralUtils {
 public:
+	static int         base64Decode(const char* in, size_t length, uint8_t* out, size_t outSize);
 	static bool        base64Decode(const std::string& in, std::string* out);
 	static bool        base64Encode(const std::string& in, std::string* out);
 	static void        dumpInfo();
-	static bool        endsWith(std::string str, char c);
+	static bool        endsWith(const std::string& str, char c);
 	static const char* errorToString(esp_err_t errCode);
 	static const char* wifiErrorToString(uint8_t value);
 	static void        hexDump(const uint8_t* pData, uint32_t length);
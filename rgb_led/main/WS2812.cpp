@@ -415,6 +415,27 @@ void WS2812::clear() {
 } // clear
 
 
+/**
+ * @brief Get the pixel data to fill it directly, e.g. to decode a frame into it.
+ *
+ * The pixels are stored as 3 bytes red, green, blue, one after the other.
+ * The LEDs are not actually updated until a call to show().
+ *
+ * @return The data of getPixelCount() pixels.
+ */
+uint8_t* WS2812::getRawPixels() {
+	return reinterpret_cast<uint8_t*>(this->pixels);
+} // getRawPixels
+
+
+/**
+ * @brief Get the number of pixels of the string.
+ */
+uint16_t WS2812::getPixelCount() {
+	return this->pixelCount;
+} // getPixelCount
+
+
 /**
  * @brief Class instance destructor.
  */
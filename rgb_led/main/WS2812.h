@@ -59,6 +59,8 @@ public:
 	void setPixel(uint16_t index, uint32_t pixel);
 	void setHSBPixel(uint16_t index, uint16_t hue, uint8_t saturation, uint8_t brightness);
 	void clear();
+	uint8_t* getRawPixels();
+	uint16_t getPixelCount();
 	virtual ~WS2812();
 
 private:
@@ -27,8 +27,14 @@
 
 #include "esp_log.h"
 #include "mqtt_client.h"
+#include "iot_core.h"
+#include "boot_timeline.h"
+#include "log_ring.h"
 
 #include "WS2812.h"
+#include "GeneralUtils.h"
+//the payloads come from our own controllers, strict JSON without comments
+#define ARDUINOJSON_ENABLE_COMMENTS 0
 #include "../ArduinoJson/ArduinoJson.hpp"
 
 static const char *TAG                  = "MQTT_EXAMPLE";
@@ -41,16 +47,13 @@ static const char* TOPIC_PANEL          = "esp/curvy/panel";
 static const char* TOPIC_BRIGHTNESS     = "esp/curvy/brightness";
 static const char* TOPIC_STATUS         = "esp/curvy/status";
 static const char* TOPIC_FLAME         = "esp/curvy/flame";
+static const char* TOPIC_STATS_GET      = "esp/curvy/stats/get";
+static const char* TOPIC_STATS          = "esp/curvy/stats";
 static const char* TOPIC_SUB            = "esp/curvy/#";
 
 
 esp_timer_handle_t periodic_timer;
 
-static EventGroupHandle_t wifi_event_group;
-const static int CONNECTED_BIT = BIT0;
-
-esp_mqtt_client_handle_t g_client;
-bool is_client_ready = false;
 float g_brightness = 1.0;
 
 const gpio_num_t BLUE_LED=(gpio_num_t)2;
@@ -109,10 +112,10 @@ class animation_t{
         animation_t(WS2812* v_leds):enabled(false),leds(v_leds){}
         void run();
         void kill();
-        void add_flash(action_flash_t &v_flash,int v_duration_ms);
-        void add_wave(action_wave_t &v_wave,int v_duration_ms);
-        void add_wavelet(action_wave_t &v_wavelet,int v_duration_ms);
-        void add_flame(action_flame_t &v_flame,int v_duration_ms);
+        void add_flash(const action_flash_t &v_flash,int v_duration_ms);
+        void add_wave(const action_wave_t &v_wave,int v_duration_ms);
+        void add_wavelet(const action_wave_t &v_wavelet,int v_duration_ms);
+        void add_flame(const action_flame_t &v_flame,int v_duration_ms);
     public:
         bool enabled;
         WS2812* leds;
@@ -258,7 +261,7 @@ bool action_t::run(WS2812* leds,int delay_ms)
     return done;
 }
 
-void animation_t::add_flash(action_flash_t &v_flash,int v_duration_ms)
+void animation_t::add_flash(const action_flash_t &v_flash,int v_duration_ms)
 {
     action_t flash_action;
     flash_action.a_type = action_type_t::flash;
@@ -269,7 +272,7 @@ void animation_t::add_flash(action_flash_t &v_flash,int v_duration_ms)
     enabled = true;
 }
 
-void animation_t::add_wave(action_wave_t &v_wave,int v_duration_ms)
+void animation_t::add_wave(const action_wave_t &v_wave,int v_duration_ms)
 {
     action_t wave_action;
     wave_action.a_type = action_type_t::wave;
@@ -280,7 +283,7 @@ void animation_t::add_wave(action_wave_t &v_wave,int v_duration_ms)
     enabled = true;
 }
 
-void animation_t::add_flame(action_flame_t &v_flame,int v_duration_ms)
+void animation_t::add_flame(const action_flame_t &v_flame,int v_duration_ms)
 {
     action_t flame_action;
     flame_action.a_type = action_type_t::flame;
@@ -364,8 +367,11 @@ void delay_ms(int delay)
     vTaskDelay(delay / portTICK_PERIOD_MS);
 }
 
+static void coalesce_render();
+
 static void animation_timer_callback(void* arg)
 {
+    coalesce_render();
     animation.run();
 }
 
@@ -403,38 +409,47 @@ void leds_set_gradient(int led_start,int nb_leds,grad_t grad, bool show = true)
     }
 }
 
-void json_led_set_all(const char * payload,int len)
+//the json_led_set_* state handlers are rendered from the frame timer, see coalesce_render()
+//they do not show(), the frame does it once for all the updates
+//the json buffers take their blocks from an arena per task, kept between the messages,
+//so that the payload size is only limited by the arena cap and not by the stack
+//the cap fits a full pixels/list, one array node per value (24 bytes with the double and
+//long long of the IDF config), doubled for the slack of the doubling blocks, plus the headers
+static const size_t render_json_nodes = g_nb_led * 3 + 16;
+static const size_t render_json_cap = 2 * render_json_nodes * sizeof(ArduinoJson::Internals::ListNode<ArduinoJson::JsonVariant>) + 1024;
+static uint8_t render_json_pool[4096];
+static ArduinoJson::JsonArena render_json_arena(render_json_cap, render_json_pool, sizeof(render_json_pool));
+static uint8_t mqtt_json_pool[1024];
+static ArduinoJson::JsonArena mqtt_json_arena(4096, mqtt_json_pool, sizeof(mqtt_json_pool));
+
+//the controllers may send the same objects in MessagePack, a map can not start a JSON text
+//the JSON text is decoded in place, the keys and strings of the object point into the payload
+static ArduinoJson::JsonObject& parse_payload(ArduinoJson::ArenaJsonBuffer &jsonBuffer, char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<200> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
-    uint8_t red = root["red"];
-    uint8_t green = root["green"];
-    uint8_t blue = root["blue"];
-    ESP_LOGI(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
-
-    animation.kill();
-    leds_set_all(red,green,blue);
+    uint8_t first = (len > 0) ? (uint8_t)payload[0] : 0;
+    if(((first & 0xF0) == 0x80) || (first == 0xDE) || (first == 0xDF))
+    {
+        return jsonBuffer.parseMsgPackObject(payload, len);
+    }
+    return jsonBuffer.parseObject(ArduinoJson::SizedJson(payload, len));
 }
 
-void json_led_set_one(const char * payload,int len)
+void json_led_set_all(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<200> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
-    uint8_t index = root["index"];
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&render_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     uint8_t red = root["red"];
     uint8_t green = root["green"];
     uint8_t blue = root["blue"];
-    ESP_LOGI(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
+    LOG_RING_I(TAG, "MQTT-JSON> rgb(%u , %u , %u)",red, green, blue);
 
-    animation.kill();
-    my_rgb.setPixel(index,red,green,blue);
-    my_rgb.show();
+    leds_set_all(red,green,blue,false);
 }
 
-void json_led_set_list(const char * payload,int len)
+void json_led_set_list(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<4096> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&render_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     if (!root.success()) 
     {
         ESP_LOGE(TAG, "MQTT-JSON> Parsing error");
@@ -442,7 +457,7 @@ void json_led_set_list(const char * payload,int len)
     }
     int size = root["leds"].size();
     int nb_leds = size / 3;
-    ESP_LOGI(TAG, "MQTT-JSON> size = %u",size);
+    LOG_RING_I(TAG, "MQTT-JSON> size = %u",size);
     animation.kill();
     for(int i=0;i<nb_leds;i++)
     {
@@ -450,24 +465,23 @@ void json_led_set_list(const char * payload,int len)
         uint8_t green   = root["leds"][3*i+1];
         uint8_t blue    = root["leds"][3*i+2];
         my_rgb.setPixel(i,red,green,blue);
-        ESP_LOGI(TAG, "MQTT-JSON> rgb[%u](%u , %u , %u)",i,red, green, blue);
+        LOG_RING_I(TAG, "MQTT-JSON> rgb[%u](%u , %u , %u)",i,red, green, blue);
     }
-    my_rgb.show();
 }
 
-void json_led_set_grad(const char * payload,int len)
+void json_led_set_grad(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<600> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&render_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     if (!root.success()) 
     {
         ESP_LOGE(TAG, "MQTT-JSON> Parsing error");
         return;
     }
     int led_start = root["led_start"];
-    ESP_LOGI(TAG, "MQTT-JSON> led_start = %d",led_start);
+    LOG_RING_I(TAG, "MQTT-JSON> led_start = %d",led_start);
     int nb_leds = root["nb_leds"];
-    ESP_LOGI(TAG, "MQTT-JSON> nb_leds = %d",nb_leds);
+    LOG_RING_I(TAG, "MQTT-JSON> nb_leds = %d",nb_leds);
     grad_t grad;
     grad.start_red   = root["col_start"]["r"];
     grad.start_green = root["col_start"]["g"];
@@ -476,12 +490,305 @@ void json_led_set_grad(const char * payload,int len)
     grad.stop_green  = root["col_stop"]["g"];
     grad.stop_blue   = root["col_stop"]["b"];
 
-    leds_set_gradient(led_start, nb_leds, grad);
+    leds_set_gradient(led_start, nb_leds, grad, false);
+}
+
+//a panel frame, decoded by json_led_set_panel: led_start then 3 raw bytes per pixel
+void led_set_frame(char * payload,int len)
+{
+    uint16_t led_start;
+    memcpy(&led_start, payload, sizeof(led_start));
+    memcpy(my_rgb.getRawPixels() + 3*led_start, payload + sizeof(led_start), len - sizeof(led_start));
+}
+
+//------------------------------- coalescing -------------------------------
+//When the commands come faster than the panel can be refreshed, only the last
+//state is worth rendering. The state commands (all, list, grad, panel frame)
+//replace the whole panel so they share a single slot where the latest one overwrites the
+//pending one, the 'one' commands are kept per pixel on top of it. Both are
+//rendered on the next frame of the animation timer with a single show().
+//The event commands (panel, flame) are not coalesced, they are queued in their
+//order and applied to the animation on the next frame, so that the animation
+//list is only used by the frame timer. An event discards the older pending
+//state, a newer state discards the pending events.
+
+//also holds a decoded panel frame, 2 + 3*g_nb_led bytes
+static const int SLOT_PAYLOAD_SIZE = 4096;
+
+struct state_slot_t{
+    topic_handler_t handler;
+    int             len;
+    char            payload[SLOT_PAYLOAD_SIZE];
+};
+
+enum class event_type_t { off, flash, wave, flame };
+
+struct event_cmd_t{
+    event_type_t type;
+    int     duration_ms;
+    union{
+        action_flash_t flash;
+        action_wave_t wave;
+        action_flame_t flame;
+    };
+};
+
+//events between two frames, 20 ms or the flame period
+static const int EVENTS_SIZE = 8;
+
+struct coalesce_stats_t{
+    uint32_t received;
+    uint32_t coalesced;
+    uint32_t rendered;
+};
+
+//triple buffer : the MQTT task fills 'back' and swaps it with 'pending',
+//the frame swaps 'pending' with 'front' and renders 'front', only the swaps are locked
+static state_slot_t slots[3];
+static state_slot_t *slot_back      = &slots[0];
+static state_slot_t *slot_pending   = &slots[1];
+static state_slot_t *slot_front     = &slots[2];
+static bool state_pending = false;
+
+static pixel_t one_pixels[g_nb_led];
+static uint32_t one_mask[(g_nb_led+31)/32];
+static int one_count = 0;
+
+static event_cmd_t events[EVENTS_SIZE];
+static int events_count = 0;
+
+static coalesce_stats_t coalesce_stats = {0,0,0};
+static portMUX_TYPE coalesce_mux = portMUX_INITIALIZER_UNLOCKED;
+
+//called in the critical section, the pending 'one' pixels are superseded by a newer state
+static void coalesce_drop_pending()
+{
+    if(state_pending)
+    {
+        state_pending = false;
+        coalesce_stats.coalesced++;
+    }
+    if(one_count)
+    {
+        coalesce_stats.coalesced += one_count;
+        one_count = 0;
+        memset(one_mask,0,sizeof(one_mask));
+    }
+}
+
+//called in the critical section, the pending events are superseded by a newer state
+static void coalesce_drop_events()
+{
+    coalesce_stats.coalesced += events_count;
+    events_count = 0;
+}
+
+//the back slot is only written by the MQTT task, it is published here once filled
+static void coalesce_state_back(topic_handler_t handler, int len)
+{
+    slot_back->handler = handler;
+    slot_back->len = len;
+    portENTER_CRITICAL(&coalesce_mux);
+    coalesce_stats.received++;
+    coalesce_drop_pending();
+    coalesce_drop_events();
+    state_slot_t *slot = slot_pending;
+    slot_pending = slot_back;
+    slot_back = slot;
+    state_pending = true;
+    portEXIT_CRITICAL(&coalesce_mux);
+}
+
+static void coalesce_state(topic_handler_t handler, const char * payload, int len)
+{
+    if(len > SLOT_PAYLOAD_SIZE)
+    {
+        LOG_RING_E(TAG, "MQTT-JSON> payload too long %d", len);
+        return;
+    }
+    memcpy(slot_back->payload, payload, len);
+    coalesce_state_back(handler, len);
+}
+
+void mqtt_led_set_all(char * payload,int len)
+{
+    coalesce_state(&json_led_set_all, payload, len);
+}
+
+void mqtt_led_set_list(char * payload,int len)
+{
+    coalesce_state(&json_led_set_list, payload, len);
+}
+
+void mqtt_led_set_grad(char * payload,int len)
+{
+    coalesce_state(&json_led_set_grad, payload, len);
 }
 
-void led_set_brightness(const char * payload,int len)
+void mqtt_led_set_one(char * payload,int len)
 {
-    float brightness = atof(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&mqtt_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
+    int index = root["index"];
+    uint8_t red = root["red"];
+    uint8_t green = root["green"];
+    uint8_t blue = root["blue"];
+    LOG_RING_I(TAG, "MQTT-JSON> rgb[%d](%u , %u , %u)",index,red, green, blue);
+    if((index < 0) || (index >= g_nb_led))
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&coalesce_mux);
+    coalesce_stats.received++;
+    coalesce_drop_events();
+    uint32_t bit = 1u << (index % 32);
+    if(one_mask[index/32] & bit)
+    {
+        coalesce_stats.coalesced++;
+    }
+    else
+    {
+        one_mask[index/32] |= bit;
+        one_count++;
+    }
+    one_pixels[index].red = red;
+    one_pixels[index].green = green;
+    one_pixels[index].blue = blue;
+    portEXIT_CRITICAL(&coalesce_mux);
+}
+
+//a state received before the event must not be rendered after it
+static bool coalesce_event(const event_cmd_t &event)
+{
+    bool queued = false;
+    portENTER_CRITICAL(&coalesce_mux);
+    coalesce_stats.received++;
+    coalesce_drop_pending();
+    if(events_count < EVENTS_SIZE)
+    {
+        events[events_count++] = event;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&coalesce_mux);
+    if(!queued)
+    {
+        LOG_RING_E(TAG, "MQTT-JSON> more than %d events in a frame, dropped", EVENTS_SIZE);
+    }
+    return queued;
+}
+
+//in the frame timer, before the animation runs
+static void apply_event(const event_cmd_t &event)
+{
+    switch(event.type)
+    {
+        case event_type_t::off :
+            leds_set_all(0,0,0);
+        break;
+        case event_type_t::flash :
+            animation.add_flash(event.flash, event.duration_ms);
+        break;
+        case event_type_t::wave :
+            animation.add_wave(event.wave, event.duration_ms);
+        break;
+        case event_type_t::flame :
+            animation.kill();
+            animation.add_flame(event.flame, event.duration_ms);
+        break;
+    }
+}
+
+//called on every frame from the animation timer
+static void coalesce_render()
+{
+    static pixel_t pixels[g_nb_led];
+    static uint32_t mask[(g_nb_led+31)/32];
+    static event_cmd_t frame_events[EVENTS_SIZE];
+    int nb_events = 0;
+    bool has_state = false;
+    bool has_one = false;
+    portENTER_CRITICAL(&coalesce_mux);
+    if(state_pending)
+    {
+        state_slot_t *slot = slot_front;
+        slot_front = slot_pending;
+        slot_pending = slot;
+        state_pending = false;
+        has_state = true;
+    }
+    if(one_count)
+    {
+        memcpy(pixels,one_pixels,sizeof(pixels));
+        memcpy(mask,one_mask,sizeof(mask));
+        memset(one_mask,0,sizeof(one_mask));
+        one_count = 0;
+        has_one = true;
+    }
+    if(events_count)
+    {
+        nb_events = events_count;
+        memcpy(frame_events,events,nb_events*sizeof(event_cmd_t));
+        events_count = 0;
+    }
+    portEXIT_CRITICAL(&coalesce_mux);
+
+    //a state and events do not come in the same frame, the newer discards the older
+    for(int i=0;i<nb_events;i++)
+    {
+        apply_event(frame_events[i]);
+    }
+    if(!has_state && !has_one)
+    {
+        return;
+    }
+    animation.kill();
+    if(has_state)
+    {
+        slot_front->handler(slot_front->payload, slot_front->len);
+    }
+    if(has_one)
+    {
+        for(int i=0;i<g_nb_led;i++)
+        {
+            if(mask[i/32] & (1u << (i % 32)))
+            {
+                my_rgb.setPixel(i,pixels[i]);
+            }
+        }
+    }
+    my_rgb.show();
+    portENTER_CRITICAL(&coalesce_mux);
+    coalesce_stats.rendered++;
+    portEXIT_CRITICAL(&coalesce_mux);
+}
+
+void mqtt_stats_get(char * payload,int len)
+{
+    coalesce_stats_t stats;
+    portENTER_CRITICAL(&coalesce_mux);
+    stats = coalesce_stats;
+    portEXIT_CRITICAL(&coalesce_mux);
+    iot_publishf(TOPIC_STATS, 1, 0, "{\"received\":%u,\"coalesced\":%u,\"rendered\":%u,\"log_dropped\":%u,"
+                    "\"json_render_hwm\":%u,\"json_mqtt_hwm\":%u,\"json_failures\":%u}",
+                    stats.received, stats.coalesced, stats.rendered, log_ring_dropped(),
+                    (unsigned)render_json_arena.highWaterMark(), (unsigned)mqtt_json_arena.highWaterMark(),
+                    (unsigned)(render_json_arena.failures() + mqtt_json_arena.failures()));
+}
+
+void led_set_brightness(char * payload,int len)
+{
+    //the payload is not null terminated, the number is copied to convert it
+    StringView text = StringView(payload, len).trim();
+    char number[16];
+    if(text.length >= sizeof(number))
+    {
+        ESP_LOGI(TAG, "MQTT-JSON> brightness too long (%d)", len);
+        return;
+    }
+    memcpy(number, text.ptr, text.length);
+    number[text.length] = '\0';
+    float brightness = atof(number);
     if((brightness > 0.01) && (brightness < 100))
     {
         g_brightness = brightness;
@@ -493,34 +800,36 @@ void led_set_brightness(const char * payload,int len)
     }
 }
 
-void led_test_flame(const char * payload,int len)
+void led_test_flame(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<600> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&mqtt_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     if (!root.success()) 
     {
         ESP_LOGE(TAG, "MQTT-JSON> Parsing error");
         return;
     }
-    animation.kill();
-
-    action_flame_t flame;
-    int duration_ms = root["duration_ms"];
+    event_cmd_t event;
+    event.type = event_type_t::flame;
+    event.duration_ms = root["duration_ms"];
     int period = root["period"];
-    flame.color.red = root["r"];
-    flame.color.green = root["g"];
-    flame.color.blue = root["b"];
-    flame.random = root["random"];
-    flame.nb_leds = root["nb_leds"];
-    animation.add_flame(flame,duration_ms);
+    event.flame.color.red = root["r"];
+    event.flame.color.green = root["g"];
+    event.flame.color.blue = root["b"];
+    event.flame.random = root["random"];
+    event.flame.nb_leds = root["nb_leds"];
+    if(!coalesce_event(event))
+    {
+        return;
+    }
     ESP_ERROR_CHECK(esp_timer_stop(periodic_timer));
     ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, period));
 }
 
-void json_led_set_panel(const char * payload,int len)
+void json_led_set_panel(char * payload,int len)
 {
-    ArduinoJson::StaticJsonBuffer<600> jsonBuffer;
-    ArduinoJson::JsonObject& root = jsonBuffer.parseObject(payload);
+    ArduinoJson::ArenaJsonBuffer jsonBuffer(&mqtt_json_arena);
+    ArduinoJson::JsonObject& root = parse_payload(jsonBuffer, payload, len);
     if (!root.success()) 
     {
         ESP_LOGE(TAG, "MQTT-JSON> Parsing error");
@@ -528,188 +837,109 @@ void json_led_set_panel(const char * payload,int len)
     }
     bool do_wave = false;
     bool is_wavelet = false;
-    std::string action = root["action"].as<std::string>();
-    if(action.compare("off") == 0)
-    {
-        animation.kill();
-        timestamp_start();
-        leds_set_all(0,0,0,false);
-        int64_t t_set_all = timestamp_stop();
-        timestamp_start();
-        my_rgb.show();
-        int64_t t_show = timestamp_stop();
+    //points into the payload, no copy
+    StringView action(root["action"].as<const char*>());
+    event_cmd_t event;
+    event.duration_ms = root["duration_ms"];
+    if(action.equals("off"))
+    {
+        event.type = event_type_t::off;
+        coalesce_event(event);
         ESP_LOGI(TAG, "MQTT-JSON> Panel Off");
-        ESP_LOGI(TAG, "MQTT-JSON> time to set all: %lld us ; time to show: %lld us", t_set_all, t_show);
     }
-    else if(action.compare("flash") == 0)
+    else if(action.equals("flash"))
     {
-        action_flash_t flash;
-        int duration_ms = root["duration_ms"];
-        flash.color.red = root["r"];
-        flash.color.green = root["g"];
-        flash.color.blue = root["b"];
-        animation.add_flash(flash,root["duration_ms"]);
-        ESP_LOGI(TAG, "MQTT-JSON> Added Flash (%u,%u,%u) for %d ms",flash.color.red,flash.color.green,flash.color.blue,duration_ms);
+        event.type = event_type_t::flash;
+        event.flash.color.red = root["r"];
+        event.flash.color.green = root["g"];
+        event.flash.color.blue = root["b"];
+        coalesce_event(event);
+        LOG_RING_I(TAG, "MQTT-JSON> Added Flash (%u,%u,%u) for %d ms",event.flash.color.red,event.flash.color.green,event.flash.color.blue,event.duration_ms);
     }
-    else if(action.compare("wave") == 0)
+    else if(action.equals("frame"))
+    {
+        //base64 of 3 bytes r,g,b per pixel from led_start, decoded straight into the back
+        //slot and rendered as a state by the frame timer, see led_set_frame()
+        const char* frame = root["frame"];
+        int led_start = root["led_start"];
+        if((frame == NULL) || (led_start < 0) || (led_start >= g_nb_led))
+        {
+            ESP_LOGE(TAG, "MQTT-JSON> frame missing or led_start out of range");
+            return;
+        }
+        uint16_t start = led_start;
+        memcpy(slot_back->payload, &start, sizeof(start));
+        uint8_t* pixels = reinterpret_cast<uint8_t*>(slot_back->payload) + sizeof(start);
+        int nb_bytes = GeneralUtils::base64Decode(frame, strlen(frame), pixels, 3*(g_nb_led - led_start));
+        if(nb_bytes < 0)
+        {
+            ESP_LOGE(TAG, "MQTT-JSON> frame is not base64 or is longer than the panel");
+            return;
+        }
+        coalesce_state_back(&led_set_frame, sizeof(start) + nb_bytes);
+        LOG_RING_I(TAG, "MQTT-JSON> Frame of %d leds from %d", nb_bytes/3, led_start);
+    }
+    else if(action.equals("wave"))
     {
         do_wave = true;
     }
-    else if(action.compare("wavelet") == 0)
+    else if(action.equals("wavelet"))
     {
         do_wave = true;
         is_wavelet = true;
     }
     if(do_wave)
     {
-        action_wave_t wave;
-        int duration_ms = root["duration_ms"];
-        wave.length = root["length"];
-        wave.freq   = root["freq"];
-        wave.is_wavelet = is_wavelet;
-        wave.color.red = root["r"];
-        wave.color.green = root["g"];
-        wave.color.blue = root["b"];
-        animation.add_wave(wave,duration_ms);
-        ESP_LOGI(TAG, "MQTT-JSON> Added Wave (%u,%u,%u) for %d ms",wave.color.red,wave.color.green,wave.color.blue,duration_ms);
+        event.type = event_type_t::wave;
+        event.wave.length = root["length"];
+        event.wave.freq   = root["freq"];
+        event.wave.is_wavelet = is_wavelet;
+        event.wave.color.red = root["r"];
+        event.wave.color.green = root["g"];
+        event.wave.color.blue = root["b"];
+        coalesce_event(event);
+        LOG_RING_I(TAG, "MQTT-JSON> Added Wave (%u,%u,%u) for %d ms",event.wave.color.red,event.wave.color.green,event.wave.color.blue,event.duration_ms);
     }
 }
 
-typedef void (*t_mqtt_handler)(const char *,int);
-
-bool match_and_call(esp_mqtt_event_handle_t &event,const char* topic,t_mqtt_handler func)
-{
-    if(strncmp(event->topic,topic,event->topic_len) == 0)
-    {
-        (*func)(event->data,event->data_len);
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-
-static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
-{
-    g_client = event->client;//update g_client
-    int msg_id;
-    // your_context_t *context = event->context;
-    switch (event->event_id) {
-        case MQTT_EVENT_CONNECTED:
-            is_client_ready = true;
-            ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
-            msg_id = esp_mqtt_client_publish(g_client, TOPIC_STATUS, "online", 0, 1, 0);
-            ESP_LOGI(TAG, "MQTT> sent publish successful, msg_id=%d", msg_id);
-
-            msg_id = esp_mqtt_client_subscribe(g_client, TOPIC_SUB, 0);
-            ESP_LOGI(TAG, "MQTT> sent subscribe successful, msg_id=%d", msg_id);
-
-            break;
-        case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-            is_client_ready = false;
-            break;
-
-        case MQTT_EVENT_SUBSCRIBED:
-            break;
-        case MQTT_EVENT_UNSUBSCRIBED:
-            ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
-            break;
-        case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-            printf("MQTT> TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("MQTT> DATA=%.*s\r\n", event->data_len, event->data);
-
-            if      (match_and_call(event,TOPIC_ALL,  &json_led_set_all))     {}
-            else if (match_and_call(event,TOPIC_LIST, &json_led_set_list))    {}
-            else if (match_and_call(event,TOPIC_ONE,  &json_led_set_one))     {}
-            else if (match_and_call(event,TOPIC_GRAD, &json_led_set_grad))    {}
-            else if (match_and_call(event,TOPIC_PANEL,&json_led_set_panel))   {}
-            else if (match_and_call(event,TOPIC_BRIGHTNESS,&led_set_brightness)) {}
-            else if (match_and_call(event,TOPIC_FLAME,&led_test_flame)) {}
-            else
-            {
-                ESP_LOGI(TAG, "MQTT> unhandled topic len=%d", event->topic_len);
-            }
-            break;
-        case MQTT_EVENT_ERROR:
-            ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
-            break;
-    }
-    return ESP_OK;
-}
-
-static esp_err_t wifi_event_handler(void *ctx, system_event_t *event)
-{
-    switch (event->event_id) {
-        case SYSTEM_EVENT_STA_START:
-            esp_wifi_connect();
-            break;
-        case SYSTEM_EVENT_STA_GOT_IP:
-            xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
-
-            break;
-        case SYSTEM_EVENT_STA_DISCONNECTED:
-            esp_wifi_connect();
-            xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
-            break;
-        default:
-            break;
-    }
-    return ESP_OK;
-}
+topic_router_t router;
 
-static void wifi_init(void)
+void mqtt_routes_init()
 {
-    tcpip_adapter_init();
-    wifi_event_group = xEventGroupCreate();
-    ESP_ERROR_CHECK(esp_event_loop_init(wifi_event_handler, NULL));
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    wifi_config_t wifi_config;
-    memset(&wifi_config,0,sizeof(wifi_config_t));
-    strcpy((char*)wifi_config.sta.ssid,CONFIG_WIFI_SSID);
-    strcpy((char*)wifi_config.sta.password,CONFIG_WIFI_PASSWORD);
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
-    ESP_LOGI(TAG, "start the WIFI SSID:[%s]", CONFIG_WIFI_SSID);
-    ESP_ERROR_CHECK(esp_wifi_start());
-    ESP_LOGI(TAG, "Waiting for wifi");
-    xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, false, true, portMAX_DELAY);
+    topic_router_init(&router);
+    topic_router_add(&router, TOPIC_ALL,        &mqtt_led_set_all);
+    topic_router_add(&router, TOPIC_LIST,       &mqtt_led_set_list);
+    topic_router_add(&router, TOPIC_ONE,        &mqtt_led_set_one);
+    topic_router_add(&router, TOPIC_GRAD,       &mqtt_led_set_grad);
+    topic_router_add(&router, TOPIC_PANEL,      &json_led_set_panel);
+    topic_router_add(&router, TOPIC_BRIGHTNESS, &led_set_brightness);
+    topic_router_add(&router, TOPIC_FLAME,      &led_test_flame);
+    topic_router_add(&router, TOPIC_STATS_GET,  &mqtt_stats_get);
 }
 
-char mqtt_uri[32];
-char mqtt_lwt_topic[32];
-char mqtt_lwt_mesg[32];
-
-static void mqtt_app_start(void)
+//stops as soon as a command is received so that the test does not overwrite it
+void leds_self_test()
 {
-    esp_mqtt_client_config_t mqtt_cfg;
-    memset(&mqtt_cfg,0,sizeof(esp_mqtt_client_config_t));
-    strcpy(mqtt_uri,CONFIG_BROKER_URL);
-    strcpy(mqtt_lwt_topic,TOPIC_STATUS);
-    strcpy(mqtt_lwt_mesg,"offline");
-    mqtt_cfg.uri = mqtt_uri;
-    mqtt_cfg.event_handle = mqtt_event_handler;
-    mqtt_cfg.lwt_topic = mqtt_lwt_topic;
-    mqtt_cfg.lwt_msg = mqtt_lwt_mesg;
-    mqtt_cfg.lwt_msg_len = 1;
-    mqtt_cfg.lwt_retain = true;
-
-    g_client = esp_mqtt_client_init(&mqtt_cfg);
-    esp_mqtt_client_start(g_client);
+    if(!iot_boot_begin())
+        return;
+    leds_set_all(1,0,0);
+    if(!iot_boot_delay_ms(500))
+        return;
+    leds_set_all(0,1,0);
+    if(!iot_boot_delay_ms(500))
+        return;
+    leds_set_all(0,0,1);
+    if(!iot_boot_delay_ms(500))
+        return;
+    leds_set_all(0,0,0);
+    iot_boot_end();
 }
 
 extern "C" void app_main();
 void app_main()
 {
     ESP_LOGI(TAG, "[APP] Startup..");
+    log_ring_init();
 
     ESP_LOGI(TAG, "[APP] Free memory: %d uint8_ts", esp_get_free_heap_size());
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
@@ -717,26 +947,18 @@ void app_main()
     esp_log_level_set("*", ESP_LOG_INFO);
     esp_log_level_set("MQTT_EXAMPLE", ESP_LOG_INFO);
 
-    leds_set_all(0,1,0);
-    delay_ms(500);
-    leds_set_all(0,0,0);
-
     nvs_flash_init();
-    
-    timestamp_start();
-    wifi_init();
-    ESP_LOGI(TAG, "[APP] wifi_init in %lld ms", timestamp_stop()/1000);
-
-    mqtt_app_start();
-
-    leds_set_all(1,0,0);
-    delay_ms(500);
-    leds_set_all(0,1,0);
-    delay_ms(500);
-    leds_set_all(0,0,1);
-    delay_ms(500);
-    leds_set_all(0,0,0);
-
+    mqtt_routes_init();
+    //the animation timer is used by the flame and panel commands
     timers_init();
+    boot_timeline_mark("leds ready");
+
+    iot_wifi_init();
+    //a full state slot or a 256 pixels frame in one message, with its topic and header
+    iot_mqtt_buffer_size(SLOT_PAYLOAD_SIZE + 256);
+    iot_mqtt_start(TOPIC_STATUS, TOPIC_SUB, &router);
 
+    //runs while the station associates
+    leds_self_test();
+    boot_timeline_mark("leds self-test");
 }